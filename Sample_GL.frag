@@ -6,9 +6,16 @@ in vec3 fragColor;
 // output data
 out vec3 color;
 
+#ifdef FEATURE_TINT
+uniform vec3 Tint;
+#endif
+
 void main()
 {
     // Output color = color specified in the vertex shader,
     // interpolated between all 3 surrounding vertices of the triangle
     color = fragColor;
+#ifdef FEATURE_TINT
+    color *= Tint;
+#endif
 }
@@ -3,6 +3,9 @@
 // input data : sent from main program
 layout (location = 0) in vec3 vertexPosition;
 layout (location = 1) in vec3 vertexColor;
+#ifdef FEATURE_INSTANCED
+layout (location = 2) in vec3 instanceOffset;
+#endif
 
 uniform mat4 MVP;
 
@@ -12,6 +15,9 @@ out vec3 fragColor;
 void main ()
 {
     vec4 v = vec4(vertexPosition, 1); // Transform an homogeneous 4D vector
+#ifdef FEATURE_INSTANCED
+    v.xyz += instanceOffset;
+#endif
 
     // The color of each vertex will be interpolated
     // to produce the color of each fragment
@@ -6,10 +6,33 @@
 #include <fstream>
 #include <vector>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
+#include <thread>
+#include <atomic>
+#include <chrono>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include "camera.h"
+#include "dynamic_resolution.h"
+#include "frame_pacing.h"
+#include "game_logic.h"
+#include "gl_hooks.h"
+#include "gpu_handle.h"
+#include "input_latency.h"
+#include "log.h"
+#include "metrics.h"
+#include "mesh_buffer.h"
+#include "mvp_batch.h"
+#include "scene_geometry.h"
+#include "stream_buffer.h"
+#include "trace.h"
+#include "shader_registry.h"
+#include "shader_variants.h"
+#include "spsc_queue.h"
+#include "triple_buffer.h"
+
 #define GLM_FORCE_RADIANS
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
@@ -17,220 +40,242 @@
 
 using namespace std;
 
+/* A mesh in scene_meshes; the name is historical, all meshes share one VAO */
 struct VAO {
-	GLuint VertexArrayID;
-	GLuint VertexBuffer;
-	GLuint ColorBuffer;
+	MeshRange Mesh;
 
 	GLenum PrimitiveMode;
 	GLenum FillMode;
 	int NumVertices;
+
+	VAO *next_free;
 };
 typedef struct VAO VAO;
 
-struct GLMatrices {
-	glm::mat4 projection;
-	glm::mat4 model;
-	glm::mat4 view;
-	GLuint MatrixID;
-} Matrices;
-
-GLuint programID;
+// Every static mesh, in one vertex and one index buffer
+#define SCENE_VERTEX_CAPACITY 65536
+#define SCENE_INDEX_CAPACITY (3*SCENE_VERTEX_CAPACITY)
+MeshBuffer scene_meshes;
 
-/* Function to load Shaders - Use it as it is */
-GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path) {
+/* VAO records come from a fixed pool; meshes are few and all made at start */
+#define MAX_VAOS 64
+VAO vao_pool[MAX_VAOS];
+VAO *vao_free_list;
+int vaos_used;
 
-	// Create the shaders
-	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
-	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
-
-	// Read the Vertex Shader code from the file
-	std::string VertexShaderCode;
-	std::ifstream VertexShaderStream(vertex_file_path, std::ios::in);
-	if(VertexShaderStream.is_open())
-	{
-		std::string Line = "";
-		while(getline(VertexShaderStream, Line))
-			VertexShaderCode += "\n" + Line;
-		VertexShaderStream.close();
+VAO *vao_alloc ()
+{
+	if (vao_free_list) {
+		VAO *vao = vao_free_list;
+		vao_free_list = vao->next_free;
+		return vao;
 	}
-
-	// Read the Fragment Shader code from the file
-	std::string FragmentShaderCode;
-	std::ifstream FragmentShaderStream(fragment_file_path, std::ios::in);
-	if(FragmentShaderStream.is_open()){
-		std::string Line = "";
-		while(getline(FragmentShaderStream, Line))
-			FragmentShaderCode += "\n" + Line;
-		FragmentShaderStream.close();
+	if (vaos_used == MAX_VAOS) {
+		fprintf(stderr, "Error: more than %d VAOs\n", MAX_VAOS);
+		exit(EXIT_FAILURE);
 	}
-
-	GLint Result = GL_FALSE;
-	int InfoLogLength;
-
-	// Compile Vertex Shader
-	printf("Compiling shader : %s\n", vertex_file_path);
-	char const * VertexSourcePointer = VertexShaderCode.c_str();
-	glShaderSource(VertexShaderID, 1, &VertexSourcePointer , NULL);
-	glCompileShader(VertexShaderID);
-
-	// Check Vertex Shader
-	glGetShaderiv(VertexShaderID, GL_COMPILE_STATUS, &Result);
-	glGetShaderiv(VertexShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	std::vector<char> VertexShaderErrorMessage(InfoLogLength);
-	glGetShaderInfoLog(VertexShaderID, InfoLogLength, NULL, &VertexShaderErrorMessage[0]);
-	fprintf(stdout, "%s\n", &VertexShaderErrorMessage[0]);
-
-	// Compile Fragment Shader
-	printf("Compiling shader : %s\n", fragment_file_path);
-	char const * FragmentSourcePointer = FragmentShaderCode.c_str();
-	glShaderSource(FragmentShaderID, 1, &FragmentSourcePointer , NULL);
-	glCompileShader(FragmentShaderID);
-
-	// Check Fragment Shader
-	glGetShaderiv(FragmentShaderID, GL_COMPILE_STATUS, &Result);
-	glGetShaderiv(FragmentShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	std::vector<char> FragmentShaderErrorMessage(InfoLogLength);
-	glGetShaderInfoLog(FragmentShaderID, InfoLogLength, NULL, &FragmentShaderErrorMessage[0]);
-	fprintf(stdout, "%s\n", &FragmentShaderErrorMessage[0]);
-
-	// Link the program
-	fprintf(stdout, "Linking program\n");
-	GLuint ProgramID = glCreateProgram();
-	glAttachShader(ProgramID, VertexShaderID);
-	glAttachShader(ProgramID, FragmentShaderID);
-	glLinkProgram(ProgramID);
-
-	// Check the program
-	glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
-	glGetProgramiv(ProgramID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	std::vector<char> ProgramErrorMessage( max(InfoLogLength, int(1)) );
-	glGetProgramInfoLog(ProgramID, InfoLogLength, NULL, &ProgramErrorMessage[0]);
-	fprintf(stdout, "%s\n", &ProgramErrorMessage[0]);
-
-	glDeleteShader(VertexShaderID);
-	glDeleteShader(FragmentShaderID);
-
-	return ProgramID;
+	return &vao_pool[vaos_used++];
 }
 
+struct GLMatrices {
+	glm::mat4 model;
+	GLuint MatrixID;
+} Matrices;
+
+// GL thread: one camera per mode, so each keeps its cached matrices while
+// multi-view shows them all, and the framebuffer size they share
+Camera cameras[NUM_CAMERA_MODES];
+int fb_width = 1, fb_height = 1;
+// What draw() renders to this frame: the window, or with dynamic
+// resolution (--scale-target) part of dynres's offscreen target
+int render_width = 1, render_height = 1;
+int dynres_enabled;
+DynamicResolution dynres;
+
+// Meshes drawn once use the plain variant (per-vertex colour only);
+// the board is instanced from offsets in instance_stream
+constexpr ShaderFeatures SCENE_SHADER = ShaderFeatures();
+constexpr ShaderFeatures INSTANCED_SHADER = SHADER_INSTANCED;
+
+#define INSTANCE_STREAM_SIZE 65536 // bytes of instance data per frame
+StreamBuffer instance_stream;
+long draw_calls;            // in the last draw(), for the trace and metrics
+
+// Vertex inputs as scene_meshes sets them up; checked against each
+// shader variant when it's built
+const VertexAttribute scene_vertex_layout[] = {
+	{ "vertexPosition", ATTRIB_POSITION, GL_FLOAT_VEC3 },
+	{ "vertexColor", ATTRIB_COLOR, GL_FLOAT_VEC3 },
+	{ "instanceOffset", ATTRIB_INSTANCE_OFFSET, GL_FLOAT_VEC3 },
+};
+
 static void error_callback(int error, const char* description)
 {
 	fprintf(stderr, "Error: %s\n", description);
 }
 
+/* Ask the main loop to stop; it shuts the simulation thread down and exits */
 void quit(GLFWwindow *window)
 {
-	glfwDestroyWindow(window);
-	glfwTerminate();
-	exit(EXIT_SUCCESS);
+	glfwSetWindowShouldClose(window, 1);
 }
 
 
-/* Generate VAO, VBOs and return VAO handle */
+/* Copy a mesh into scene_meshes and return its handle */
 struct VAO* create3DObject (GLenum primitive_mode, int numVertices, const GLfloat* vertex_buffer_data, const GLfloat* color_buffer_data, GLenum fill_mode=GL_FILL)
 {
-	struct VAO* vao = new struct VAO;
+	struct VAO* vao = vao_alloc();
 	vao->PrimitiveMode = primitive_mode;
 	vao->NumVertices = numVertices;
 	vao->FillMode = fill_mode;
 
-	// Create Vertex Array Object
-	// Should be done after CreateWindow and before any other GL calls
-	glGenVertexArrays(1, &(vao->VertexArrayID)); // VAO
-	glGenBuffers (1, &(vao->VertexBuffer)); // VBO - vertices
-	glGenBuffers (1, &(vao->ColorBuffer));  // VBO - colors
-
-	glBindVertexArray (vao->VertexArrayID); // Bind the VAO 
-	glBindBuffer (GL_ARRAY_BUFFER, vao->VertexBuffer); // Bind the VBO vertices 
-	glBufferData (GL_ARRAY_BUFFER, 3*numVertices*sizeof(GLfloat), vertex_buffer_data, GL_STATIC_DRAW); // Copy the vertices into VBO
-	glVertexAttribPointer(
-			0,                  // attribute 0. Vertices
-			3,                  // size (x,y,z)
-			GL_FLOAT,           // type
-			GL_FALSE,           // normalized?
-			0,                  // stride
-			(void*)0            // array buffer offset
-			);
-
-	glBindBuffer (GL_ARRAY_BUFFER, vao->ColorBuffer); // Bind the VBO colors 
-	glBufferData (GL_ARRAY_BUFFER, 3*numVertices*sizeof(GLfloat), color_buffer_data, GL_STATIC_DRAW);  // Copy the vertex colors
-	glVertexAttribPointer(
-			1,                  // attribute 1. Color
-			3,                  // size (r,g,b)
-			GL_FLOAT,           // type
-			GL_FALSE,           // normalized?
-			0,                  // stride
-			(void*)0            // array buffer offset
-			);
+	// Interleave positions and colours into the shared vertex format
+	std::vector<MeshVertex> vertices (numVertices);
+	for (int i=0; i<numVertices; i++) {
+		for (int j=0; j<3; j++) {
+			vertices[i].position[j] = vertex_buffer_data[3*i + j];
+			vertices[i].color[j] = color_buffer_data[3*i + j];
+		}
+	}
+	if (!mesh_alloc(&scene_meshes, &vertices[0], numVertices, NULL, 0, &vao->Mesh)) {
+		fprintf(stderr, "Error: mesh buffer full (%d vertices more)\n", numVertices);
+		exit(EXIT_FAILURE);
+	}
 
 	return vao;
 }
 
-/* Generate VAO, VBOs and return VAO handle - Common Color for all vertices */
+/* Same, with a common colour for all vertices */
 struct VAO* create3DObject (GLenum primitive_mode, int numVertices, const GLfloat* vertex_buffer_data, const GLfloat red, const GLfloat green, const GLfloat blue, GLenum fill_mode=GL_FILL)
 {
-	GLfloat* color_buffer_data = new GLfloat [3*numVertices];
+	std::vector<GLfloat> color_buffer_data (3*numVertices);
 	for (int i=0; i<numVertices; i++) {
 		color_buffer_data [3*i] = red;
 		color_buffer_data [3*i + 1] = green;
 		color_buffer_data [3*i + 2] = blue;
 	}
 
-	return create3DObject(primitive_mode, numVertices, vertex_buffer_data, color_buffer_data, fill_mode);
+	return create3DObject(primitive_mode, numVertices, vertex_buffer_data, &color_buffer_data[0], fill_mode);
 }
 
-/* Render the VBOs handled by VAO */
+/* Give the mesh's space back and return the record to the pool */
+void destroy3DObject (struct VAO* vao)
+{
+	if (!vao)
+		return;
+	mesh_free(&scene_meshes, &vao->Mesh);
+	vao->next_free = vao_free_list;
+	vao_free_list = vao;
+}
+
+/* Render a mesh; scene_meshes must be bound (draw does it once per frame) */
 void draw3DObject (struct VAO* vao)
 {
 	// Change the Fill Mode for this object
 	glPolygonMode (GL_FRONT_AND_BACK, vao->FillMode);
 
-	// Bind the VAO to use
-	glBindVertexArray (vao->VertexArrayID);
-
-	// Enable Vertex Attribute 0 - 3d Vertices
-	glEnableVertexAttribArray(0);
-	// Bind the VBO to use
-	glBindBuffer(GL_ARRAY_BUFFER, vao->VertexBuffer);
-
-	// Enable Vertex Attribute 1 - Color
-	glEnableVertexAttribArray(1);
-	// Bind the VBO to use
-	glBindBuffer(GL_ARRAY_BUFFER, vao->ColorBuffer);
-
 	// Draw the geometry !
-	glDrawArrays(vao->PrimitiveMode, 0, vao->NumVertices); // Starting from vertex 0; 3 vertices total -> 1 triangle
+	mesh_draw(&vao->Mesh, vao->PrimitiveMode);
+	draw_calls++;
+}
+
+/* Render count copies of a mesh, offset by the bound instance attribute */
+void draw3DObjectInstanced (struct VAO* vao, int count)
+{
+	glPolygonMode (GL_FRONT_AND_BACK, vao->FillMode);
+	mesh_draw_instanced(&vao->Mesh, vao->PrimitiveMode, count);
+	draw_calls++;
 }
 
 /**************************
  * Customizable functions *
  **************************/
-int  pos_x, pos_y;
 int  pos_z=1.5;
-//int g1=rand() % 11 +1;
-//int g2=rand() % 11 + 1;
-int A[11]; // holes
-int B[11]; // obstacles
-int C[11]; //moving tiles
+
+#define SIM_HZ 120                 // fixed simulation rate, independent of the display
+#define SIM_DT (1.0/SIM_HZ)
+#define RESHUFFLE_TICKS (6*SIM_HZ) // obstacles move every 6 seconds
+#define MOVING_TILE_SPEED 30.0f    // moving tile height change, units per second
+#define MOVING_TILE_RANGE 3.0f
+
+/* Everything one simulation tick produces; the renderer interpolates
+   between the previous and the current one */
+/* Camera state driven by input. It is part of the world so the renderer
+   gets it in the same snapshot as the game state it goes with */
+struct ViewState {
+	CameraMode mode;
+	int multi_view;     // all camera modes at once, in a grid
+	float angle_offset; // horizontal scrolling, degrees
+	float zoom;         // vertical scrolling, eye height offset
+	float drag_angle;   // helicopter mouse drag, degrees
+	int left_button, right_button;
+	double cursor_x;
+};
+
+struct WorldState {
+	GameState game;
+	Layout layout; // holes, obstacles and moving tiles
+	float k;       // height of the moving tiles
+	int hula;      // moving tiles going up
+	long tick;
+	long input_seq; // input events applied so far
+	ViewState view;
+	int quit;      // Escape or Q was pressed
+};
+WorldState world; // owned by the simulation thread once it runs
+Rng rng;
+
+/* What the simulation publishes each tick: the last two states so the
+   renderer can interpolate, and when the newer one was produced */
+struct WorldSnapshot {
+	WorldState prev, cur;
+	double time;
+};
+
+/* The GLFW callbacks only record what happened; the simulation thread
+   applies the events in arrival order at the start of its next tick */
+enum InputType { INPUT_KEY, INPUT_CHAR, INPUT_MOUSE_BUTTON, INPUT_SCROLL, INPUT_CURSOR };
+
+struct InputEvent {
+	double time;   // glfwGetTime() when the callback ran
+	int type;
+	int code;      // key, character or mouse button
+	int action;
+	double x, y;   // scroll offsets or cursor position
+};
+
+SpscQueue<InputEvent, 1024> input_queue;
+unsigned input_dropped;       // events lost to a full queue (GL thread only)
+long input_events;            // simulation thread only
+LatencyTracker input_latency; // callback to tick, swap and GPU completion
+std::atomic<bool> sim_running(false);
+
+/* Idle mode (--idle): the main loop sleeps in glfwWaitEventsTimeout and
+   draws only when the scene changed, or at idle_hz for the moving tiles.
+   The simulation thread wakes it with glfwPostEmptyEvent when something
+   other than the tile animation changed */
+#define IDLE_MAX_WAIT 0.5          // still poll shader builds and reloads this often
+int idle_mode;
+double idle_hz = 10;               // 0: moving tiles only move on other changes
+std::atomic<bool> redraw_needed(true); // window damaged or resized
+long frames_drawn, idle_wakeups;
+
+// Vsync by default; --pacing and --fps choose another mode (frame_pacing.h)
+FramePacer pacer;
+
+// --metrics: live values in shared memory, and with --metrics-socket on a
+// Unix socket too (metrics.h)
+int metrics_enabled;
+Metrics metrics;
 void r()
 {
-	for (int i=0; i<10; i++)
-	{
-		A[i] = rand() % 11 + 1;
-		//	B[i] = rand() % 11 + 1;
-		C[i] = rand() % 11 + 1; 
-
-	}
+	layout_generate(&world.layout, &rng);
 }
 
 void rand_obj()
 {
-	//srand((int)time(0));
-	for (int i=0; i<10; i++)
-	{
-		B[i] = rand() % 11 + 1;
-	}	
+	TRACE_SCOPE("reshuffle");
+	layout_shuffle_obstacles(&world.layout, &rng);
 }
 
 class Player
@@ -238,125 +283,9 @@ class Player
 	//	VAO *cube;
 	int x, y, z;
 	public:
-	int score;
 	VAO *cube;
 	void createCube(){
-		static const GLfloat vertex_buffer_data[] = {
-
-			-0.5f,-0.5f,-0.5f, // triangle 1 : begin
-
-			-0.5f,-0.5f, 0.5f,
-
-			-0.5f, 0.5f, 0.5f, // triangle 1 : end
-
-			0.5f, 0.5f,-0.5f, // triangle 2 : begin
-
-			-0.5f,-0.5f,-0.5f,
-
-			-0.5f, 0.5f,-0.5f, // triangle 2 : end
-
-			0.5f,-0.5f, 0.5f,
-
-			-0.5f,-0.5f,-0.5f,
-
-			0.5f,-0.5f,-0.5f,
-
-			0.5f, 0.5f,-0.5f,
-
-			0.5f,-0.5f,-0.5f,
-
-			-0.5f,-0.5f,-0.5f,
-
-			-0.5f,-0.5f,-0.5f,
-
-			-0.5f, 0.5f, 0.5f,
-
-			-0.5f, 0.5f,-0.5f,
-
-			0.5f,-0.5f, 0.5f,
-
-			-0.5f,-0.5f, 0.5f,
-
-			-0.5f,-0.5f,-0.5f,
-
-			-0.5f, 0.5f, 0.5f,
-
-			-0.5f,-0.5f, 0.5f,
-
-			0.5f,-0.5f, 0.5f,
-
-			0.5f, 0.5f, 0.5f,
-
-			0.5f,-0.5f,-0.5f,
-
-			0.5f, 0.5f,-0.5f,
-
-			0.5f,-0.5f,-0.5f,
-
-			0.5f, 0.5f, 0.5f,
-
-			0.5f,-0.5f, 0.5f,
-
-			0.5f, 0.5f, 0.5f,
-
-			0.5f, 0.5f,-0.5f,
-
-			-0.5f, 0.5f,-0.5f,
-
-			0.5f, 0.5f, 0.5f,
-
-			-0.5f, 0.5f,-0.5f,
-
-			-0.5f, 0.5f, 0.5f,
-
-			0.5f, 0.5f, 0.5f,
-
-			-0.5f, 0.5f, 0.5f,
-
-			0.5f,-0.5f, 0.5f
-
-		};
-		static const GLfloat color_buffer_data[] = {
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1,
-			1,1,1
-
-		};
-
-		cube = create3DObject(GL_TRIANGLES, 36, vertex_buffer_data, color_buffer_data, GL_FILL);
+		cube = create3DObject(GL_TRIANGLES, player_mesh.num_vertices, player_mesh.vertices, player_mesh.colors, GL_FILL);
 	}
 	int get_x(){
 		return x;
@@ -374,9 +303,6 @@ class Player
 	int set_y(int b){
 		this -> y =b;
 	}
-	int get_score(){
-		return score;
-	}
 };
 
 Player player;
@@ -392,121 +318,7 @@ class Obstacle
 	public:
 	VAO *cuboid;
 	void createCuboid(){
-		static const GLfloat vertex_buffer_data[] = {
-
-			-0.5f,-0.5f,-0.5f, // triangle 1 : begin
-
-			-0.5f,-0.5f, 0.5f,
-
-			-0.5f, 0.5f, 0.5f, // triangle 1 : end
-
-			0.5f, 0.5f,-0.5f, // triangle 2 : begin
-
-			-0.5f,-0.5f,-0.5f,
-
-			-0.5f, 0.5f,-0.5f, // triangle 2 : end
-
-			0.5f,-0.5f, 0.5f,
-
-			-0.5f,-0.5f,-0.5f,
-
-			0.5f,-0.5f,-0.5f,
-
-			0.5f, 0.5f,-0.5f,
-
-			0.5f,-0.5f,-0.5f,
-
-			-0.5f,-0.5f,-0.5f,
-
-			-0.5f,-0.5f,-0.5f,
-
-			-0.5f, 0.5f, 0.5f,
-
-			-0.5f, 0.5f,-0.5f,
-
-			0.5f,-0.5f, 0.5f,
-
-			-0.5f,-0.5f, 0.5f,
-
-			-0.5f,-0.5f,-0.5f,
-
-			-0.5f, 0.5f, 0.5f,
-
-			-0.5f,-0.5f, 0.5f,
-
-			0.5f,-0.5f, 0.5f,
-
-			0.5f, 0.5f, 0.5f,
-
-			0.5f,-0.5f,-0.5f,
-
-			0.5f, 0.5f,-0.5f,
-
-			0.5f,-0.5f,-0.5f,
-
-			0.5f, 0.5f, 0.5f,
-
-			0.5f,-0.5f, 0.5f,
-
-			0.5f, 0.5f, 0.5f,
-
-			0.5f, 0.5f,-0.5f,
-
-			-0.5f, 0.5f,-0.5f,
-
-			0.5f, 0.5f, 0.5f,
-
-			-0.5f, 0.5f,-0.5f,
-
-			-0.5f, 0.5f, 0.5f,
-
-			0.5f, 0.5f, 0.5f,
-
-			-0.5f, 0.5f, 0.5f,
-
-			0.5f,-0.5f, 0.5f
-
-		};
-		static const GLfloat color_buffer_data[] = {
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0,
-			0,0,0
-		};
-
-		cuboid = create3DObject(GL_TRIANGLES, 36, vertex_buffer_data, color_buffer_data, GL_FILL);
+		cuboid = create3DObject(GL_TRIANGLES, obstacle_mesh.num_vertices, obstacle_mesh.vertices, obstacle_mesh.colors, GL_FILL);
 	}
 
 	int get_x()
@@ -529,280 +341,186 @@ Obstacle obstacle;
 
 
 
-int top=0;
-int tower=1;
-int player_view, follow_view=0;
-int helicopter=0;
 float triangle_rot_dir = 1;
 float rectangle_rot_dir = 1;
 bool triangle_rot_status = true;
 bool rectangle_rot_status = true;
-int up, down, lft, rght;
-int spce, uspce, lspce, dspce, rspce;
 
-float camera_rotation_angle;
-int a, b, c;
-int cura, curb;
-/* Executed when a regular key is pressed/released/held-down */
-/* Prefered for Keyboard events */
-void keyboard (GLFWwindow* window, int key, int scancode, int action, int mods)
+/* Directions moved in since the last jump; Space jumps in all of them */
+int jump_dirs;
+
+static void apply_key (int key, int action)
 {
+	GameState *game = &world.game;
+	const Layout *layout = &world.layout;
+	ViewState *view = &world.view;
+
 	// Function is called first on GLFW_PRESS.
 
 	if (action == GLFW_RELEASE) {
 		switch (key) {
-			/*case GLFW_KEY_C:
-			  rectangle_rot_status = !rectangle_rot_status;
-			  break;
-			  case GLFW_KEY_P:
-			  triangle_rot_status = !triangle_rot_status;
-			  break;
-			  case GLFW_KEY_X:
-			// do something ..
-			break;*/
 			case GLFW_KEY_UP:
-				//				pos_y=player.get_y;
-				uspce=1;
-				if ( B[pos_x]==pos_y+1 || A[pos_x]==pos_y+1 || C[pos_x]==pos_y+1)
-				{
-					pos_x=0;
-					pos_y=0;
-					player.score-=10;
-				}
-				else if (pos_y+1==9 && pos_x==9)
-				{
-					pos_y+=1;
-					player.score+=100;
-					cout << "YOU WIN!" << endl;
-					quit(window);
-				}
-				else if ( pos_y<9)
-				{
-					up=1;
-
-					/*	pos_y+=1;
-
-						player.set_y(pos_y);*/
-					break;
-				}
-				else
-					break;
+				game_move(game, layout, DIR_UP);
+				jump_dirs |= 1 << DIR_UP;
+				break;
 			case GLFW_KEY_DOWN:
-				//				pos_y=player.get_y;
-				dspce=1;
-				if ( B[pos_x]==pos_y-1 || A[pos_x]==pos_y-1 || C[pos_x]==pos_y-1)
-				{
-					pos_x=0;
-					pos_y=0;
-					player.score-=10;
-				}
-				else if (pos_y-1==9 && pos_x==9)
-				{
-					pos_y-=1;
-					player.score+=100;
-					cout << "YOU WIN!" << endl;
-					quit(window);
-				}
-				else if (pos_y>0)
-				{
-					down=1;
-					break;
-				}
-				else
-					break;
-
+				game_move(game, layout, DIR_DOWN);
+				jump_dirs |= 1 << DIR_DOWN;
+				break;
 			case GLFW_KEY_LEFT:
-				lspce=1;
-				if ( B[pos_x-1]==pos_y || A[pos_x-1]==pos_y || C[pos_x-1]==pos_y)
-				{
-					pos_x=0;
-					pos_y=0;
-					player.score-=10;
-				}
-				else if (pos_y==9 && pos_x-1==9)
-				{
-					pos_x-=1;
-					player.score+=100;
-					cout << "YOU WIN!" << endl;
-					quit(window);
-				}
-				else if (pos_x>0)
-				{
-					lft=1;
-					break;
-				}
-				else
-					break;
+				game_move(game, layout, DIR_LEFT);
+				jump_dirs |= 1 << DIR_LEFT;
+				break;
 			case GLFW_KEY_RIGHT:
-				rspce=1;
-				if ( B[pos_x+1]==pos_y || A[pos_x+1]==pos_y || C[pos_x+1]==pos_y)
-				{
-					player.score-=10;
-					pos_x=0;
-					pos_y=0;
-				}
-				else if (pos_y==9 && pos_x+1==9)
-				{
-					pos_x+=1;
-					player.score+=100;
-					cout << "YOU WIN!" << endl;
-					quit(window);
-				}
-				else if(pos_x<9)
-				{
-					rght=1;
-					break;
-				}
-				else
-					break;
+				game_move(game, layout, DIR_RIGHT);
+				jump_dirs |= 1 << DIR_RIGHT;
+				break;
 			case GLFW_KEY_SPACE:
-				spce=1;
+				// Space jumps two tiles in the direction(s) pressed before it
+				for (int dir=0; dir<NUM_DIRECTIONS; dir++)
+					if (jump_dirs & (1 << dir))
+						game_jump(game, layout, (Direction)dir);
+				jump_dirs = 0;
+				break;
 			case GLFW_KEY_T:
-				tower=0;
-				top=1;
-				player_view=0;
-				follow_view=0;
-				helicopter=0;
+				view->mode = CAMERA_TOP;
 				break;
-
 			case GLFW_KEY_O:
-				tower=1;
-				top=0;
-				player_view=0;
-				follow_view=0;
-				helicopter=0;
+				view->mode = CAMERA_TOWER;
 				break;
-
 			case GLFW_KEY_P:
-				player_view=1;
-				tower=0;
-				top=0;
-				follow_view=0;
-				helicopter=0;
+				view->mode = CAMERA_PLAYER;
 				break;
-
 			case GLFW_KEY_C:
-				follow_view=1;
-				tower=0;
-				top=0;
-				player_view=0;
-				helicopter=0;
+				view->mode = CAMERA_FOLLOW;
 				break;
-
 			case GLFW_KEY_H:
-				follow_view=0;
-				tower=0;
-				top=0;
-				player_view=0;
-				helicopter=1;
-				break;
-			case GLFW_KEY_F:
-
+				view->mode = CAMERA_HELICOPTER;
 				break;
-			case GLFW_KEY_S:
+			case GLFW_KEY_V:
+				view->multi_view = !view->multi_view;
+				LOG(LOG_DEBUG, "multi-view %s", view->multi_view ? "on" : "off");
 				break;
-
-
 			default:
 				break;
-
 		}
 	}
 	else if (action == GLFW_PRESS) {
 		switch (key) {
 			case GLFW_KEY_ESCAPE:
-				quit(window);
+				world.quit = 1;
 				break;
 			default:
 				break;
-
-				//			case GLFW_KEY_UP:
-				//
 		}
 	}
 }
 
-/* Executed for character input (like in text boxes) */
-void keyboardChar (GLFWwindow* window, unsigned int key)
+/* Simulation thread: apply one input event to the world */
+void apply_input (const InputEvent &event)
 {
-	switch (key) {
-		case 'Q':
-		case 'q':
-			quit(window);
+	ViewState *view = &world.view;
+
+	switch (event.type) {
+		case INPUT_KEY:
+			apply_key(event.code, event.action);
 			break;
-		default:
+		case INPUT_CHAR:
+			if (event.code == 'Q' || event.code == 'q')
+				world.quit = 1;
 			break;
-	}
-}
-int left_button;
-int right_button;
-/* Executed when a mouse button is pressed/released */
-void mouseButton (GLFWwindow* window, int button, int action, int mods)
-{
-	switch (button) {
-		case GLFW_MOUSE_BUTTON_LEFT:
-			if (action == GLFW_PRESS)
-				left_button=1;
-			else
-				left_button=0;
+		case INPUT_MOUSE_BUTTON:
+			if (event.code == GLFW_MOUSE_BUTTON_LEFT)
+				view->left_button = event.action == GLFW_PRESS;
+			else if (event.code == GLFW_MOUSE_BUTTON_RIGHT)
+				view->right_button = event.action == GLFW_PRESS;
+			break;
+		case INPUT_SCROLL:
+			// one step per scroll event: zoom on y, rotate on x
+			if (event.y < 0)
+				view->zoom += 1;
+			if (event.y > 0)
+				view->zoom -= 1;
+			if (event.x > 0)
+				view->angle_offset += 1;
+			if (event.x < 0)
+				view->angle_offset -= 1;
+			LOG(LOG_DEBUG, "camera angle offset %.0f, zoom %.0f", view->angle_offset, view->zoom);
 			break;
-		case GLFW_MOUSE_BUTTON_RIGHT:
-			if (action == GLFW_PRESS) {
-				right_button=1;
+		case INPUT_CURSOR:
+			// Dragging with the left button orbits the helicopter camera
+			if ((view->mode == CAMERA_HELICOPTER || view->multi_view) && view->left_button==1)
+			{
+				if (event.x < view->cursor_x)
+					view->drag_angle -= 1;
+				else if (event.x > view->cursor_x)
+					view->drag_angle += 1;
 			}
-			else
-				right_button=0;
+			view->cursor_x = event.x;
 			break;
 		default:
 			break;
 	}
 }
-int scroll_down=0;
-int scroll_up=0;
-int scroll_left=0;
-int scroll_right=0;
-void scroll ( GLFWwindow *window , double x, double y)
+
+/* Simulation thread: drain the input queue, oldest first */
+void drain_input ()
 {
-	float p,g;
-	p=float(y)/4;
-	g=float(x)/4;
-	//cout << g;
-	if ( p<0 )
-	{
-		scroll_down=1;
-	}
-	if (p>0 )
-	{
-		scroll_up=1;
-	}
-	if ( g>0 )
-	{
-		scroll_left=1;
+	InputEvent event;
+	double now = glfwGetTime();
+	while (input_queue.pop(event)) {
+		input_events++;
+		apply_input(event);
+		latency_applied(&input_latency, ++world.input_seq, event.time, now);
 	}
-	if ( g<0 )
-	{
-		scroll_right=1;
+}
+
+static void push_input (int type, int code, int action, double x, double y)
+{
+	InputEvent event = { glfwGetTime(), type, code, action, x, y };
+	if (!input_queue.push(event)) {
+		input_dropped++;
+		LOG(LOG_WARN, "input queue full, %u events dropped", input_dropped);
 	}
 }
 
+/* Executed when a regular key is pressed/released/held-down */
+/* Prefered for Keyboard events */
+void keyboard (GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	if (action != GLFW_REPEAT)
+		push_input(INPUT_KEY, key, action, 0, 0);
+}
+
+/* Executed for character input (like in text boxes) */
+void keyboardChar (GLFWwindow* window, unsigned int key)
+{
+	push_input(INPUT_CHAR, key, 0, 0, 0);
+}
+
+/* Executed when a mouse button is pressed/released */
+void mouseButton (GLFWwindow* window, int button, int action, int mods)
+{
+	push_input(INPUT_MOUSE_BUTTON, button, action, 0, 0);
+}
+
+void scroll ( GLFWwindow *window , double x, double y)
+{
+	push_input(INPUT_SCROLL, 0, 0, x, y);
+}
+
 void cursormove(GLFWwindow* window, double x, double y)
 {
-	float cura = a;
-	float curb = b;
-	if ( helicopter==1 && left_button==1)
-	{
-		float a1=(float)x/4.0;
-		if ( a1<0)
-			camera_rotation_angle -=1;
-		else if( a1>0)
-			camera_rotation_angle +=1;
-
-		a=10*cos(camera_rotation_angle*M_PI/180.0f);
-		b=-10*sin(camera_rotation_angle*M_PI/180.0f);
-	}
+	push_input(INPUT_CURSOR, 0, 0, x, y);
 }
 
 
+/* Executed when part of the window needs drawing again */
+void refreshWindow (GLFWwindow* window)
+{
+	redraw_needed = true;
+}
+
 /* Executed when window is resized to 'width' and 'height' */
 /* Modify the bounds of the screen here in glm::ortho or Field of View in glm::Perspective */
 void reshapeWindow (GLFWwindow* window, int width, int height)
@@ -812,18 +530,19 @@ void reshapeWindow (GLFWwindow* window, int width, int height)
 	   is different from WindowSize */
 	glfwGetFramebufferSize(window, &fbwidth, &fbheight);
 
-	GLfloat fov = 90.0f;
-
-	// sets the viewport of openGL renderer
+	// sets the viewport of openGL renderer; draw() sets it per view from
+	// fb_width and fb_height
 	glViewport (0, 0, (GLsizei) fbwidth, (GLsizei) fbheight);
+	fb_width = fbwidth;
+	fb_height = fbheight;
+	redraw_needed = true;
 
 	// set the projection matrix as perspective
 	/* glMatrixMode (GL_PROJECTION);
 	   glLoadIdentity ();
 	   gluPerspective (fov, (GLfloat) fbwidth / (GLfloat) fbheight, 0.1, 500.0); */
-	// Store the projection matrix in a variable for future use
-	// Perspective projection for 3D views
-	Matrices.projection = glm::perspective (fov, (GLfloat) fbwidth / (GLfloat) fbheight, 1.0f, 500.0f);
+	// Perspective projection for 3D views: draw() gives each camera the
+	// aspect of its view
 
 	// Ortho projection for 2D views
 	//Matrices.projection = glm::ortho(-4.0f, 4.0f, -4.0f, 4.0f, 0.1f, 500.0f);
@@ -886,388 +605,198 @@ void createRectangle ()
 
 void createCube()
 {
-	static const GLfloat vertex_buffer_data[] = {
-
-		-0.5f,-0.5f,-9.5f, // triangle 1 : begin
-
-		-0.5f,-0.5f, 0.5f,
-
-		-0.5f, 0.5f, 0.5f, // triangle 1 : end
-
-		0.5f, 0.5f,-9.5f, // triangle 2 : begin
-
-		-0.5f,-0.5f,-9.5f,
-
-		-0.5f, 0.5f,-9.5f, // triangle 2 : end
-
-		0.5f,-0.5f, 0.5f,
-
-		-0.5f,-0.5f,-9.5f,
-
-		0.5f,-0.5f,-9.5f,
-
-		0.5f, 0.5f,-9.5f,
-
-		0.5f,-0.5f,-9.5f,
-
-		-0.5f,-0.5f,-9.5f,
-
-		-0.5f,-0.5f,-9.5f,
-
-		-0.5f, 0.5f, 0.5f,
-
-		-0.5f, 0.5f,-9.5f,
-
-		0.5f,-0.5f, 0.5f,
-
-		-0.5f,-0.5f, 0.5f,
-
-		-0.5f,-0.5f,-9.5f,
-
-		-0.5f, 0.5f, 0.5f,
-
-		-0.5f,-0.5f, 0.5f,
-
-		0.5f,-0.5f, 0.5f,
-
-		0.5f, 0.5f, 0.5f,
-
-		0.5f,-0.5f,-9.5f,
-
-		0.5f, 0.5f,-9.5f,
-
-		0.5f,-0.5f,-9.5f,
-
-		0.5f, 0.5f, 0.5f,
-
-		0.5f,-0.5f, 0.5f,
-
-		0.5f, 0.5f, 0.5f,
-
-		0.5f, 0.5f,-9.5f,
-
-		-0.5f, 0.5f,-9.5f,
-
-		0.5f, 0.5f, 0.5f,
-
-		-0.5f, 0.5f,-9.5f,
-
-		-0.5f, 0.5f, 0.5f,
-
-		0.5f, 0.5f, 0.5f,
-
-		-0.5f, 0.5f, 0.5f,
-
-		0.5f,-0.5f, 0.5f
-
-	};
-	static const GLfloat color_buffer_data[] = {
-
-		0.583f,  0.771f,  0.014f,
-
-		0.609f,  0.115f,  0.436f,
-
-		0.327f,  0.483f,  0.844f,
-
-		0.822f,  0.569f,  0.201f,
-
-		0.435f,  0.602f,  0.223f,
-
-		0.310f,  0.747f,  0.185f,
-
-		0.597f,  0.770f,  0.761f,
-
-		0.559f,  0.436f,  0.730f,
-
-		0.359f,  0.583f,  0.152f,
-
-		0.483f,  0.596f,  0.789f,
-
-		0.559f,  0.861f,  0.639f,
-
-		0.195f,  0.548f,  0.859f,
-
-		0.014f,  0.184f,  0.576f,
-
-		0.771f,  0.328f,  0.970f,
-
-		0.406f,  0.615f,  0.116f,
-
-		0.676f,  0.977f,  0.133f,
-
-		0.971f,  0.572f,  0.833f,
-
-		0.140f,  0.616f,  0.489f,
-
-		0.997f,  0.513f,  0.064f,
-
-		0.945f,  0.719f,  0.592f,
-
-		0.543f,  0.021f,  0.978f,
-
-		0.279f,  0.317f,  0.505f,
-
-		0.167f,  0.620f,  0.077f,
-
-		0.347f,  0.857f,  0.137f,
-
-		0.055f,  0.953f,  0.042f,
-
-		0.714f,  0.505f,  0.345f,
-
-		0.783f,  0.290f,  0.734f,
-
-		0.722f,  0.645f,  0.174f,
-
-		0.302f,  0.455f,  0.848f,
-
-		0.225f,  0.587f,  0.040f,
-
-		0.517f,  0.713f,  0.338f,
-
-		0.053f,  0.959f,  0.120f,
-
-		0.393f,  0.621f,  0.362f,
-
-		0.673f,  0.211f,  0.457f,
-
-		0.820f,  0.883f,  0.371f,
-
-		0.982f,  0.099f,  0.879f
-
-	};
-
-	cube = create3DObject(GL_TRIANGLES, 36, vertex_buffer_data, color_buffer_data, GL_FILL);
+	cube = create3DObject(GL_TRIANGLES, floor_mesh.num_vertices, floor_mesh.vertices, floor_mesh.colors, GL_FILL);
 }
 
 //float camera_rotation_angle;
 float rectangle_rotation = 0;
 float triangle_rotation = 0;
-int  d, e, f, g, h, i;
-float k;
-int hula;
-int temp;/* Render the scene with openGL */
-/* Edit this function according to your assignment */
-void draw ()
+/* Advance the game by one fixed step of SIM_DT seconds */
+void update ()
 {
-	if (up==1)
-	{
-		pos_y+=1;
-		player.set_y(pos_y);
-		up=0;
-	}
-	if (down==1)
+	// Moving tiles bounce between -MOVING_TILE_RANGE and MOVING_TILE_RANGE
+	float step = MOVING_TILE_SPEED * (float)SIM_DT;
+	if (world.hula==1)
 	{
-		pos_y-=1;
-		player.set_y(pos_y);
-		down=0;
-	}
-	if (lft==1)
-	{
-		pos_x-=1;
-		player.set_x(pos_x);
-		lft=0;
-	}
-	if (rght==1)
-	{
-		pos_x+=1;
-		player.set_x(pos_x);
-		rght=0;
-	}
-
-
-	if (spce==1 && uspce==1 && pos_y+2<=10)
-	{
-		if ( A[pos_x]==pos_y+2 || B[pos_x]==pos_y+2)
-		{
-			pos_x=0;
-			pos_y=0;
-			player.score-=10;
-		}
-		else 
+		world.k += step;
+		if (world.k >= MOVING_TILE_RANGE)
 		{
-			pos_y+=2;
-			uspce=0;
-			spce=0;
+			world.k = MOVING_TILE_RANGE;
+			world.hula = 0;
 		}
 	}
-
-	if (spce==1 && dspce==1 && pos_y-2>=0)
+	else
 	{
-		if ( A[pos_x]==pos_y-2 || B[pos_x]==pos_y-2)
-		{
-			pos_x=0;
-			pos_y=0;
-			player.score-=10;
-		}
-		else
+		world.k -= step;
+		if (world.k <= -MOVING_TILE_RANGE)
 		{
-			pos_y-=2;
-			spce=0;
-			dspce=0;
+			world.k = -MOVING_TILE_RANGE;
+			world.hula = 1;
 		}
 	}
 
-	if (spce==1 && lspce==1 && (pos_x-2)>=0)
+	world.tick++;
+	if (world.tick % RESHUFFLE_TICKS == 0)
+		rand_obj();
+
+	// Increment angles
+	float increments = 1;
+	triangle_rotation = triangle_rotation + increments*triangle_rot_dir*triangle_rot_status;
+	rectangle_rotation = rectangle_rotation + increments*rectangle_rot_dir*rectangle_rot_status;
+}
+
+/* A view's rectangle in the render target. One view fills it; the
+   multi-view layout is a grid of 3 columns, first view top left */
+struct Viewport {
+	int x, y, width, height;
+};
+
+static Viewport view_viewport (int view, int num_views)
+{
+	Viewport cell = { 0, 0, render_width, render_height };
+	if (num_views == 1)
+		return cell;
+	int cols = 3, rows = (num_views + cols - 1) / cols;
+	cell.width = render_width / cols;
+	cell.height = render_height / rows;
+	cell.x = (view % cols) * cell.width;
+	cell.y = (rows - 1 - view / cols) * cell.height;
+	return cell;
+}
+
+/* This frame's copies of one mesh: offsets in instance_stream for the GPU
+   and in CPU memory for culling, which never reads the mapped buffer */
+struct InstanceList {
+	VAO *mesh;
+	glm::vec3 min, max;  // bounds of the mesh
+	GLintptr offset;     // first instance in instance_stream
+	int count;
+	glm::vec3 at[BOARD_SIZE*BOARD_SIZE];
+};
+
+struct SceneInstances {
+	InstanceList tiles, obstacles;
+};
+
+static void add_instance (InstanceList *list, GLfloat *stream, float x, float y, float z)
+{
+	list->at[list->count] = glm::vec3(x, y, z);
+	stream[3*list->count] = x;
+	stream[3*list->count + 1] = y;
+	stream[3*list->count + 2] = z;
+	list->count++;
+}
+
+/* Write the floor tiles and obstacles for this frame, once for all views */
+static void prepare_instances (const Layout &layout, float k, SceneInstances *scene)
+{
+	InstanceList *tiles = &scene->tiles, *obstacles = &scene->obstacles;
+	tiles->mesh = cube;
+	obstacles->mesh = obstacle.cuboid;
+	mesh_bounds(&floor_mesh, &tiles->min[0], &tiles->max[0]);
+	mesh_bounds(&obstacle_mesh, &obstacles->min[0], &obstacles->max[0]);
+	tiles->count = obstacles->count = 0;
+
+	stream_begin_frame(&instance_stream);
+	GLfloat *tile_stream = (GLfloat*) stream_alloc(&instance_stream, 3*sizeof(GLfloat)*BOARD_SIZE*BOARD_SIZE, 16, &tiles->offset);
+	GLfloat *obstacle_stream = (GLfloat*) stream_alloc(&instance_stream, 3*sizeof(GLfloat)*BOARD_SIZE, 16, &obstacles->offset);
+	int i, j;
+	for (i=0; i<10 && tile_stream && obstacle_stream; i++)
 	{
-		if ( A[pos_x-2]==pos_y || B[pos_x-2]==pos_y )
-		{
-			pos_x=0;
-			pos_y=0;
-			player.score-=10;
-		}
-		else
+		for (j=0; j<10; j++)
 		{
-			pos_x-=2;
-			lspce=0;
-			spce=0;
+			if (layout.holes[i]!=j && layout.moving[i]!=j)
+				add_instance(tiles, tile_stream, i, j, 0);
+			if (layout.moving[i]==j && layout.moving[i]!=layout.obstacles[i])
+				add_instance(tiles, tile_stream, i, j, k);
+			if (layout.obstacles[i]==j)
+				add_instance(obstacles, obstacle_stream, i, j, 1.5);
 		}
 	}
+	stream_end_frame(&instance_stream);
+}
 
-	if (spce==1 && rspce==1 && (pos_x+2)<=10)
+/* Draw the instances in list that camera can see: one instanced draw per
+   run of consecutive visible ones, pointing the instance attribute at the
+   run's first offset. The instanced program must be in use */
+static void draw_visible (Camera *camera, const InstanceList &list)
+{
+	int run = 0;
+	for (int n=0; n<=list.count; n++)
 	{
-		if ( A[pos_x+2]==pos_y || B[pos_x+2]==pos_y)
+		if (n < list.count && camera->box_visible(list.at[n] + list.min, list.at[n] + list.max))
 		{
-			pos_x=0;
-			pos_y=0;
-			player.score-=10;
-			//		break;
+			run++;
+			continue;
 		}
-		else
+		if (run > 0)
 		{
-			pos_x+=2;
-			spce=0;
-			rspce=0;
+			mesh_buffer_instances(instance_stream.buffer.get(), list.offset + 3*sizeof(GLfloat)*(n - run));
+			draw3DObjectInstanced(list.mesh, run);
+			run = 0;
 		}
-		//break;
 	}
-	if ( tower==1)
-		camera_rotation_angle=120;
-	else if( top==1)
-		camera_rotation_angle=60;
-	else if ( helicopter ==1 )
-		camera_rotation_angle = 45;
-	// clear the color and depth in the frame buffer
-	glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
 
-	// use the loaded shader program
-	// Don't change unless you know what you are doing
-	glUseProgram (programID);
+/* Render the scene with openGL, alpha in [0,1] blends prev_state into state */
+/* Edit this function according to your assignment */
+void draw (const WorldState &prev_state, const WorldState &state, float alpha)
+{
+	TRACE_SCOPE("draw");
+	const Layout &layout = state.layout;
+	draw_calls = 0;
 
-	// Eye - Location of camera. Don't change unless you are sure!!
-	/*	if (tower==1)
-		{
-		glm::vec3 eye ( 10*cos(camera_rotation_angle*M_PI/180.0f), -10*sin(camera_rotation_angle*M_PI/180.0f), 7 );
-		}
-		else if (top==1)
-		{*/
-	
-	if (scroll_right==1)
+	// Slide between tiles, but snap on respawn instead of sliding across the board
+	float pos_x = state.game.pos_x, pos_y = state.game.pos_y;
+	if (abs(state.game.pos_x - prev_state.game.pos_x) + abs(state.game.pos_y - prev_state.game.pos_y) <= 2)
 	{
-		cout << "in " << endl;
-		camera_rotation_angle--;
-		cout << camera_rotation_angle << endl;
+		pos_x = prev_state.game.pos_x + (pos_x - prev_state.game.pos_x) * alpha;
+		pos_y = prev_state.game.pos_y + (pos_y - prev_state.game.pos_y) * alpha;
 	}
-	if (scroll_left ==1 )
+	float k = prev_state.k + (state.k - prev_state.k) * alpha;
+	player.set_x(state.game.pos_x);
+	player.set_y(state.game.pos_y);
+
+	// One camera per view; each recomputes view and VP only if its pose
+	// differs from last frame's
+	trace_begin("cameras");
+	const ViewState &view = state.view;
+	int num_views = view.multi_view ? NUM_CAMERA_MODES : 1;
+	CameraMode modes[NUM_CAMERA_MODES];
+	for (int v=0; v<num_views; v++)
 	{
-		camera_rotation_angle+=1;
+		modes[v] = view.multi_view ? (CameraMode) v : view.mode;
+		Viewport cell = view_viewport(v, num_views);
+		Camera *camera = &cameras[modes[v]];
+		camera->set_aspect(cell.width, cell.height);
+		camera->set_pose(camera_pose(modes[v], view.angle_offset, view.zoom, view.drag_angle, pos_x, pos_y));
 	}
+	trace_end();
+	// clear the color and depth in the frame buffer
+	glViewport (0, 0, render_width, render_height);
+	glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	
+	// Every mesh lives in scene_meshes, so this is the only VAO bind
+	mesh_buffer_bind(&scene_meshes);
 
-	
-	if (tower==1)
-	{
-		a=10*cos(camera_rotation_angle*M_PI/180.0f);
-		b=-10*sin(camera_rotation_angle*M_PI/180.0f);
-		c=7;
-	}
-	else if (top==1)
-	{
-		a=5;
-		b=5;
-		c=7;
-	}
-	else if (player_view==1)
-	{
-		a=pos_x;
-		b=pos_y;
-		c=3;
+	// Floor tiles and obstacles go into the stream buffer once, whatever
+	// the number of views; each view culls and draws from the same data
+	SceneInstances scene;
+	trace_begin("instances");
+	prepare_instances(layout, k, &scene);
+	trace_end();
 
-	}
-	else if(follow_view==1)
-	{
-		a=pos_x;
-		b=pos_y-3;
-		c=4;
-	}
-	else if (helicopter==1)
-	{
-		a=10*cos(camera_rotation_angle*M_PI/180.0f);
-		b=-10*sin(camera_rotation_angle*M_PI/180.0f);
-		c=7;
-	}
-	if ( scroll_up==1)
-		c--;
-	if (scroll_down==1)
-		c++;
-	glm::vec3 eye ( a,b,c);
-	//glm::vec3 eye ( 5,5,7);
-	//	}
-	//glm::vec3 eye ( 10*cos(camera_rotation_angle*M_PI/180.0f), -10*sin(camera_rotation_angle*M_PI/180.0f), 7 );
-	// Target - Where is the camera looking at.  Don't change unless you are sure!!
-	/*	if (tower==1)
-		{
-		glm::vec3 target (4, 0, 0);
-		}
-		else if ( top==1)
-		{*/
-	if (player_view==1)
-	{
-		g=pos_x;
-		h=pos_y+1;
-		i=3;
-	}
-	else if(follow_view==1)
-	{
-		g=pos_x;
-		h=pos_y;
-		i=4;
-	}
-	else
-	{
-		g=5;
-		h=5;
-		i=0;
-	}
-	glm::vec3 target (g,h,i);
-	//	}
-	// Up - Up vector defines tilt of camera.  Don't change unless you are sure!!
-	//	if ( tower==1 || player_view==1)
-	//glm::vec3 up (0, 0, 1);
-	if ( top==1)
-	{
-		d=0;
-		e=1;
-		f=0;
-	}
+	// use the loaded shader program
+	// Don't change unless you know what you are doing
+	const ShaderVariant *shader = shader_variant(SCENE_SHADER);
+	glUseProgram (shader->program.get());
+	// Get a handle for our "MVP" uniform
+	Matrices.MatrixID = shader->mvp;
 
-	else
-	{
-		d=0;
-		e=0;
-		f=1;
-	}
-	glm::vec3 up (d,e,f);
-	// Compute Camera matrix (view)
-	Matrices.view = glm::lookAt( eye, target, up ); // Rotating Camera for 3D
+	// Eye, target and up come from camera_pose (camera.cpp)
 	//  Don't change unless you are sure!!
 	//Matrices.view = glm::lookAt(glm::vec3(0,0,3), glm::vec3(0,0,0), glm::vec3(0,1,0)); // Fixed camera for 2D (ortho) in XY plane
 
-	// Compute ViewProject matrix as view/camera might not be changed for this frame (basic scenario)
-	//  Don't change unless you are sure!!
-	glm::mat4 VP = Matrices.projection * Matrices.view;
-
 	// Send our transformation to the currently bound shader, in the "MVP" uniform
 	// For each model you render, since the MVP will be different (at least the M part)
 	//  Don't change unless you are sure!!
@@ -1304,102 +833,87 @@ void draw ()
 	//draw3DObject(rectangle);
 	 */
 
-	Matrices.model = glm::mat4(1.0f);
-	glm::mat4 translateCube = glm::translate (glm::vec3(pos_x, pos_y, pos_z));        // glTranslatef
-	//glm::mat4 rotateRectangle = glm::rotate((float)(rectangle_rotation*M_PI/180.0f), glm::vec3(0,0,1)); // rotate about vector (-1,1,1)
-	Matrices.model *= translateCube;
-	MVP = VP * Matrices.model;
-	glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
-
-	// draw3DObject draws the VAO given to it using current MVP matrix
-	draw3DObject(player.cube);
-
-	int i, j;
-	//r();
-
-	for (i=0; i<10; i++)
+	// The player in every view, then the board in every view: one program
+	// switch per pass, not per view
+	trace_begin("player pass");
+	float player_at[3] = { pos_x, pos_y, (float) pos_z };
+	ModelBatch player_model = { player_at, NULL, NULL };
+	for (int v=0; v<num_views; v++)
 	{
-		//g1=rand() % 11 + 1; 
-		for (j=0; j<10; j++)
-		{
-			if (A[i]!=j && C[i]!=j) //A gives holes
-			{	
-				Matrices.model = glm::mat4(1.0f);
-				glm::mat4 translateCube = glm::translate (glm::vec3(i, j, 0));        // glTranslatef
-				//glm::mat4 rotateRectangle = glm::rotate((float)(rectangle_rotation*M_PI/180.0f), glm::vec3(0,0,1)); // rotate about vector (-1,1,1)
-				Matrices.model *= translateCube;
-				MVP = VP * Matrices.model;
-				glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
-
-				// draw3DObject draws the VAO given to it using current MVP matrix
-				draw3DObject(cube);
-			}
-			if (C[i]==j && C[i]!=B[i])
-			{
-
-				Matrices.model = glm::mat4(1.0f);
-				glm::mat4 translateCube = glm::translate (glm::vec3(i, j, k));        // glTranslatef
-				//glm::mat4 rotateRectangle = glm::rotate((float)(rectangle_rotation*M_PI/180.0f), glm::vec3(0,0,1)); // rotate about vector (-1,1,1)
+		Camera *camera = &cameras[modes[v]];
+		Viewport cell = view_viewport(v, num_views);
+		glViewport (cell.x, cell.y, cell.width, cell.height);
 
-				Matrices.model *= translateCube;
-				MVP = VP * Matrices.model;
-				glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
+		// The model is a translation: VP with its last column moved, no mat4 product
+		mvp_batch<TRANSFORM_TRANSLATE>(&camera->view_projection()[0][0], player_model, 1, &MVP[0][0]);
+		glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
 
-				// draw3DObject draws the VAO given to it using current MVP matrix
-				draw3DObject(cube);
-			}
-		}
-	}
-	if (hula==1 &&  k<3)
-	{
-		k=k+0.5;
-		//hula=1;
+		// draw3DObject draws the VAO given to it using current MVP matrix
+		draw3DObject(player.cube);
 	}
-	if (k==3)
-		hula=0;
-	if ( hula==0 && k>-3)
-	{
-		k=k-0.5;
-		//hula=0;
-	}
-	if (k<=-3)
-	{	
-		hula=1;
-	}
-
-	for (i=0; i<10; i++)
-	{
-		for (j=0; j<10; j++)
-		{
-			if (B[i]==j)
-			{
-
-
-
 
-				Matrices.model = glm::mat4(1.0f);
-				glm::mat4 translateCuboid = glm::translate (glm::vec3(i, j, 1.5));        // glTranslatef
-				//glm::mat4 rotateRectangle = glm::rotate((float)(rectangle_rotation*M_PI/180.0f), glm::vec3(0,0,1)); // rotate about vector (-1,1,1)
-				Matrices.model *= translateCuboid;
-				MVP = VP * Matrices.model;
-				glUniformMatrix4fv(Matrices.MatrixID, 1, GL_FALSE, &MVP[0][0]);
+	trace_end();
 
-				// draw3DObject draws the VAO given to it using current MVP matrix
-				draw3DObject(obstacle.cuboid);
-
-			}
-		}
+	// Model is a translation per instance, so the uniform is just VP
+	trace_begin("board pass");
+	const ShaderVariant *instanced = shader_variant(INSTANCED_SHADER);
+	glUseProgram (instanced->program.get());
+	for (int v=0; v<num_views; v++)
+	{
+		Camera *camera = &cameras[modes[v]];
+		Viewport cell = view_viewport(v, num_views);
+		glViewport (cell.x, cell.y, cell.width, cell.height);
+		glUniformMatrix4fv(instanced->mvp, 1, GL_FALSE, &camera->view_projection()[0][0]);
+		draw_visible(camera, scene.tiles);
+		draw_visible(camera, scene.obstacles);
 	}
+	stream_fence(&instance_stream);
+	trace_end();
 
-	// Increment angles
-	float increments = 1;
-
-	//camera_rotation_angle++; // Simulating camera rotation
-	triangle_rotation = triangle_rotation + increments*triangle_rot_dir*triangle_rot_status;
-	rectangle_rotation = rectangle_rotation + increments*rectangle_rot_dir*rectangle_rot_status;
+	trace_counter("draw calls", draw_calls);
+	trace_counter("uploaded bytes", instance_stream.used);
+}
 
+/* Everything draw() shows except the moving tiles' height */
+static bool same_scene (const WorldState &a, const WorldState &b)
+{
+	return a.game.pos_x == b.game.pos_x && a.game.pos_y == b.game.pos_y && a.game.won == b.game.won
+		&& a.quit == b.quit && !memcmp(&a.layout, &b.layout, sizeof(Layout))
+		&& a.view.mode == b.view.mode && a.view.multi_view == b.view.multi_view
+		&& a.view.angle_offset == b.view.angle_offset && a.view.zoom == b.view.zoom
+		&& a.view.drag_angle == b.view.drag_angle;
+}
 
+/* Simulation thread: fixed-rate ticks, publishing a snapshot after each */
+void simulate (TripleBuffer<WorldSnapshot> *snapshots)
+{
+	trace_thread_name("simulation");
+	double next_tick = glfwGetTime();
+	while (sim_running.load(std::memory_order_relaxed)) {
+		trace_begin("tick");
+		// Input is applied at the start of the tick, in arrival order
+		drain_input();
+
+		WorldSnapshot &snap = snapshots->write_buffer();
+		snap.prev = world;
+		update();
+		snap.cur = world;
+		snap.time = glfwGetTime();
+		snapshots->publish();
+		if (idle_mode && !same_scene(snap.prev, snap.cur))
+			glfwPostEmptyEvent();
+		trace_end();
+		if (world.game.won || world.quit)
+			break;
 
+		next_tick += SIM_DT;
+		double now = glfwGetTime();
+		// After a stall (suspend, debugger) don't try to catch up all at once
+		if (next_tick < now - 0.25)
+			next_tick = now;
+		if (next_tick > now)
+			std::this_thread::sleep_for(std::chrono::duration<double>(next_tick - now));
+	}
 }
 
 /* Initialise glfw window, I/O callbacks and the renderer to use */
@@ -1427,7 +941,7 @@ GLFWwindow* initGLFW (int width, int height)
 
 	glfwMakeContextCurrent(window);
 	gladLoadGLLoader((GLADloadproc) glfwGetProcAddress);
-	glfwSwapInterval( 1 );
+	// The swap interval is set by pacing_init
 
 	/* --- register callbacks with GLFW --- */
 
@@ -1447,6 +961,9 @@ GLFWwindow* initGLFW (int width, int height)
 	/* Register function to handle mouse click */
 	glfwSetMouseButtonCallback(window, mouseButton);  // mouse button clicks
 
+	/* Register function to redraw a damaged window in idle mode */
+	glfwSetWindowRefreshCallback(window, refreshWindow);
+
 	glfwSetScrollCallback(window, scroll);
 	glfwSetCursorPosCallback(window, cursormove);
 	return window;
@@ -1458,19 +975,30 @@ GLFWwindow* initGLFW (int width, int height)
 /* Add all the models to be created here */
 void initGL (GLFWwindow* window, int width, int height)
 {
+	// Print the seed so the layout can be replayed with level_eval
+	uint64_t seed = (uint64_t) time(0);
+	cout << "SEED: " << seed << endl;
+	rng_seed(&rng, seed);
+	world.view.mode = CAMERA_TOWER;
+	// layout_generate shuffles the obstacles too, so this is exactly
+	// layout_from_seed(seed); rng goes on to drive the reshuffles
 	r();
-	rand_obj();
 	/* Objects should be created before any other gl function and shaders */
+	mesh_buffer_create(&scene_meshes, SCENE_VERTEX_CAPACITY, SCENE_INDEX_CAPACITY);
+	stream_buffer_create(&instance_stream, GL_ARRAY_BUFFER, INSTANCE_STREAM_SIZE);
 	// Create the models
 	//createTriangle (); // Generate the VAO, VBOs, vertices data & copy into the array buffer
 	//createRectangle ();
 	createCube();
 	player.createCube();
 	obstacle.createCuboid();
-	// Create and compile our GLSL program from the shaders
-	programID = LoadShaders( "Sample_GL.vert", "Sample_GL.frag" );
-	// Get a handle for our "MVP" uniform
-	Matrices.MatrixID = glGetUniformLocation(programID, "MVP");
+	// Create and compile our GLSL program from the shaders, off the frame
+	// loop; main() picks it up with shader_async_poll
+	static_assert(shader_index("Sample_GL.vert") >= 0 && shader_index("Sample_GL.frag") >= 0, "shader not embedded");
+	shader_variants_init(window, "Sample_GL.vert", "Sample_GL.frag",
+			scene_vertex_layout, sizeof(scene_vertex_layout) / sizeof(scene_vertex_layout[0]));
+	shader_variant(SCENE_SHADER);
+	shader_variant(INSTANCED_SHADER);
 
 
 	reshapeWindow (window, width, height);
@@ -1492,36 +1020,223 @@ int main (int argc, char** argv)
 {
 	int width = 1000;
 	int height = 1000;
+	int pacing = PACING_VSYNC;
+	double fps_cap = 60;
+	double scale_target_ms = 0;
+	float scale_min = 0.5f, scale_max = 1, scale_hysteresis = 0.1f;
+	const char *trace_path = NULL;
+	const char *gl_calls_path = NULL;
+	const char *metrics_socket = NULL;
+	for (int i=1; i<argc; i++) {
+		if (!strcmp(argv[i], "--idle"))
+			idle_mode = 1;
+		else if (!strcmp(argv[i], "--idle-hz") && i+1 < argc)
+			idle_hz = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--pacing") && i+1 < argc && (pacing = pacing_mode_from_name(argv[i+1])) >= 0)
+			i++;
+		else if (!strcmp(argv[i], "--fps") && i+1 < argc)
+			fps_cap = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--scale-target") && i+1 < argc)
+			scale_target_ms = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--scale-min") && i+1 < argc)
+			scale_min = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--scale-max") && i+1 < argc)
+			scale_max = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--scale-hysteresis") && i+1 < argc)
+			scale_hysteresis = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--trace") && i+1 < argc)
+			trace_path = argv[++i];
+		else if (!strcmp(argv[i], "--gl-calls") && i+1 < argc)
+			gl_calls_path = argv[++i];
+		else if (!strcmp(argv[i], "--metrics"))
+			metrics_enabled = 1;
+		else if (!strcmp(argv[i], "--metrics-socket") && i+1 < argc) {
+			metrics_socket = argv[++i];
+			metrics_enabled = 1;
+		}
+		else {
+			fprintf(stderr, "usage: %s [--idle] [--idle-hz N] [--pacing vsync|adaptive|uncapped|cap] [--fps N]\n"
+					"          [--scale-target MS [--scale-min F] [--scale-max F] [--scale-hysteresis F]]\n"
+					"          [--trace FILE.json] [--gl-calls FILE.csv] [--metrics] [--metrics-socket PATH]\n", argv[0]);
+			exit(EXIT_FAILURE);
+		}
+	}
 
+	// Messages from the frame loop and the simulation go through a
+	// background writer (log.h)
+	log_init(stdout);
+	if (metrics_enabled && !metrics_open(&metrics, metrics_socket))
+		exit(EXIT_FAILURE);
 	GLFWwindow* window = initGLFW(width, height);
+	// Count and check every GL call from here on (gl_hooks.h)
+	if (gl_calls_path && !gl_hooks_install(gl_calls_path))
+		exit(EXIT_FAILURE);
+	pacing_init(&pacer, window, (PacingMode) pacing, fps_cap);
 
 	initGL (window, width, height);
+	if (scale_target_ms > 0) {
+		dynres_create(&dynres, scale_target_ms, scale_min, scale_max, scale_hysteresis);
+		dynres_enabled = 1;
+	}
+	latency_init(&input_latency);
 
-	double last_update_time = glfwGetTime(), current_time;
+	// Spans from here on, the simulation's included, written at exit (trace.h)
+	if (trace_path) {
+		trace_start();
+		trace_thread_name("render");
+	}
 
-	/* Draw in loop */
+	WorldSnapshot initial = { world, world, glfwGetTime() };
+	TripleBuffer<WorldSnapshot> snapshots(initial);
+	sim_running = true;
+	std::thread sim_thread(simulate, &snapshots);
+
+	/* Render the newest complete snapshot as often as the display allows,
+	   or in idle mode only when there is something new to show. From here
+	   on world belongs to the simulation thread: start from the snapshot */
+	WorldState drawn = initial.cur;
+	double last_draw = 0, idle_start = glfwGetTime();
+	double last_present = glfwGetTime();
+	bool shaders_ready = false;
 	while (!glfwWindowShouldClose(window)) {
+		TRACE_SCOPE("frame");
 
-		// OpenGL Draw commands
-		draw();
+		// Poll for Keyboard and mouse events
+		if (!idle_mode) {
+			TRACE_SCOPE("poll events");
+			glfwPollEvents();
+		}
+		else {
+			TRACE_SCOPE("wait events");
+			// Sleep until input, a scene change (the simulation posts an
+			// empty event) or the next animation frame
+			double wait = shaders_ready ? IDLE_MAX_WAIT : SIM_DT;
+			if (idle_hz > 0)
+				wait = min(wait, max(0.0, last_draw + 1/idle_hz - glfwGetTime()));
+			glfwWaitEventsTimeout(wait);
+			idle_wakeups++;
+		}
 
-		// Swap Frame Buffer in double buffering
-		glfwSwapBuffers(window);
+		const WorldSnapshot &snap = snapshots.read();
+		if (snap.cur.game.won || snap.cur.quit)
+			break;
 
-		// Poll for Keyboard and mouse events
-		glfwPollEvents();
-
-		// Control based on time (Time based transformation like 5 degrees rotation every 0.5s)
-		current_time = glfwGetTime(); // Time in seconds
-		if ((current_time - last_update_time) >= 6) { // atleast 0.5s elapsed since last frame
-			// do something every 0.5 seconds ..
-			rand_obj();
-			last_update_time = current_time;
+		// Swap in newly built (or hot-reloaded) programs
+		trace_begin("shader poll");
+		bool rebuilt = shader_variants_poll();
+		trace_end();
+		if (!shader_variant(SCENE_SHADER) || !shader_variant(INSTANCED_SHADER)) {
+			// Placeholder frame until the first program is ready
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			glfwSwapBuffers(window);
+			gl_hooks_frame();
+			continue;
+		}
+		shaders_ready = true;
+
+		if (idle_mode) {
+			// Skip draw and swap unless something visible changed
+			double now = glfwGetTime();
+			bool animate = idle_hz > 0 && now >= last_draw + 1/idle_hz;
+			bool damaged = redraw_needed.exchange(false);
+			if (!animate && !rebuilt && !damaged && same_scene(drawn, snap.cur))
+				continue;
+			drawn = snap.cur;
+			last_draw = now;
+		}
+
+		// The scene goes to dynres's target at the scale the last frames'
+		// GPU times call for, and is then stretched to the window
+		if (dynres_enabled) {
+			dynres_begin(&dynres, fb_width, fb_height);
+			render_width = dynres.render_width;
+			render_height = dynres.render_height;
+		}
+		else {
+			render_width = fb_width;
+			render_height = fb_height;
+		}
+
+		if (idle_mode) {
+			// Frames are far apart, so show the newest state as it is
+			draw(snap.cur, snap.cur, 1);
+		}
+		else {
+			// Interpolate from the last two ticks; snapshots arrive SIM_DT apart
+			double alpha = (glfwGetTime() - snap.time) / SIM_DT;
+			alpha = alpha < 0 ? 0 : (alpha > 1 ? 1 : alpha);
+
+			// OpenGL Draw commands
+			draw(snap.prev, snap.cur, (float)alpha);
+		}
+		if (dynres_enabled) {
+			TRACE_SCOPE("upscale");
+			dynres_end(&dynres);
+		}
+		// Timestamp the events this frame is the first to show
+		latency_frame(&input_latency, snap.cur.input_seq);
+		frames_drawn++;
+
+		// Swap Frame Buffer in double buffering; idle frames are irregular
+		// on purpose, so they stay out of the pacing statistics
+		if (!idle_mode) {
+			TRACE_SCOPE("pacing wait");
+			pacing_wait(&pacer);
+		}
+		trace_begin("swap");
+		glfwSwapBuffers(window);
+		trace_end();
+		gl_hooks_frame();
+		double presented = glfwGetTime();
+		latency_presented(&input_latency, presented);
+		if (metrics_enabled) {
+			MetricsFrame frame = { presented, presented - last_present, draw_calls, gpu_stats.buffer_bytes,
+				snap.cur.tick, snap.cur.input_seq, input_latency.recent_swap,
+				snap.cur.game.score, snap.cur.game.deaths };
+			metrics_publish(&metrics, frame);
 		}
+		last_present = presented;
+		if (!idle_mode)
+			pacing_presented(&pacer);
 	}
-	int score;
-	score=player.score;
-	cout << "SCORE: " << score << endl;
+	pacing_report(&pacer, stdout);
+	if (dynres_enabled)
+		dynres_report(&dynres, stdout);
+	gl_hooks_report(stdout);
+	if (idle_mode)
+		printf("IDLE: %ld frames drawn in %.1f s, %ld wakeups\n", frames_drawn, glfwGetTime() - idle_start, idle_wakeups);
+	sim_running = false;
+	sim_thread.join();
+	if (metrics_enabled)
+		metrics_close(&metrics);
+	if (trace_path)
+		trace_write(trace_path);
+	log_shutdown();
+	if (log_dropped() > 0)
+		printf("LOG: %ld records dropped\n", log_dropped());
+
+	if (world.game.won)
+		cout << "YOU WIN!" << endl;
+	cout << "SCORE: " << world.game.score << endl;
+	if (input_events > 0 || input_dropped > 0)
+		printf("INPUT: %ld events, %u dropped\n", input_events, input_dropped);
+	latency_report(&input_latency, stdout);
+	// Release everything while the context is still current
+	destroy3DObject(triangle);
+	destroy3DObject(rectangle);
+	destroy3DObject(cube);
+	destroy3DObject(player.cube);
+	destroy3DObject(obstacle.cuboid);
+	stream_report(&instance_stream, "instances", stdout);
+	stream_buffer_destroy(&instance_stream);
+	latency_destroy(&input_latency);
+	if (dynres_enabled)
+		dynres_destroy(&dynres);
+	mesh_buffer_destroy(&scene_meshes);
+	shader_variants_shutdown();
+	if (gpu_report(stdout) > 0)
+		fprintf(stderr, "Warning: GPU objects still alive at shutdown\n");
+	gl_hooks_uninstall();
 	glfwTerminate();
 	exit(EXIT_SUCCESS);
 }
@@ -0,0 +1,159 @@
+/* Throughput benchmark and consistency check for BatchEnv
+ *
+ *   ./batch_bench [--games N] [--steps N] [--threads N]
+ *
+ * First steps a SIMD batch and a scalar (game_logic) batch side by side
+ * from the same seeds and compares every array, then times the SIMD path
+ * with pre-generated random actions. With --threads the N games are split
+ * into one BatchEnv shard per thread, each created, reset and stepped by
+ * its own thread, and the throughput reported is the aggregate.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "batch_env.h"
+
+using namespace std;
+
+static int same_state (const BatchEnv *a, const BatchEnv *b)
+{
+	int n = a->n;
+	return !memcmp(a->pos_x, b->pos_x, n*sizeof(int32_t)) && !memcmp(a->pos_y, b->pos_y, n*sizeof(int32_t))
+		&& !memcmp(a->score, b->score, n*sizeof(int32_t)) && !memcmp(a->deaths, b->deaths, n*sizeof(int32_t))
+		&& !memcmp(a->steps, b->steps, n*sizeof(int32_t)) && !memcmp(a->result, b->result, n*sizeof(int32_t))
+		&& !memcmp(a->shuffle_timer, b->shuffle_timer, n*sizeof(int32_t))
+		&& !memcmp(a->obstacles, b->obstacles, BOARD_SIZE*a->stride*sizeof(int32_t))
+		&& !memcmp(a->holes, b->holes, BOARD_SIZE*a->stride*sizeof(int32_t))
+		&& !memcmp(a->moving, b->moving, BOARD_SIZE*a->stride*sizeof(int32_t));
+}
+
+/* One thread's share of the timed run: games [first, first+n) */
+struct Shard {
+	int first, n;
+	const vector<int32_t> *actions;
+	const vector<uint64_t> *seeds;
+	int action_sets, games;
+	long long steps;
+	chrono::steady_clock::time_point start, end; // out: of the stepping
+};
+
+static void run_shard (Shard *shard)
+{
+	// Created here so the shard's arrays are first touched, and placed, by
+	// the thread that steps them
+	BatchEnv env;
+	batch_env_create(&env, shard->n, 200, 12, 3);
+	vector<int32_t> obs(shard->n);
+	vector<float> rewards(shard->n);
+	vector<uint8_t> done(shard->n);
+	batch_env_reset(&env, &(*shard->seeds)[shard->first], &obs[0]);
+	shard->start = chrono::steady_clock::now();
+	for (long long s=0; s<shard->steps; s++)
+		batch_env_step(&env, &(*shard->actions)[(size_t)(s % shard->action_sets) * shard->games + shard->first],
+				&obs[0], &rewards[0], &done[0]);
+	shard->end = chrono::steady_clock::now();
+	batch_env_destroy(&env);
+}
+
+int main (int argc, char** argv)
+{
+	int games = 4096;
+	long long steps = 20000;
+	int threads = 1;
+	for (int i=1; i+1<argc; i+=2)
+	{
+		if (!strcmp(argv[i], "--games"))
+			games = atoi(argv[i+1]);
+		else if (!strcmp(argv[i], "--steps"))
+			steps = atoll(argv[i+1]);
+		else if (!strcmp(argv[i], "--threads"))
+			threads = atoi(argv[i+1]);
+	}
+	if (threads < 1 || threads > games)
+	{
+		fprintf(stderr, "Error: --threads must be between 1 and the number of games\n");
+		return EXIT_FAILURE;
+	}
+
+	// A ring of random action vectors so action generation stays out of the timing
+	const int action_sets = 64;
+	vector<int32_t> actions((size_t)action_sets * games);
+	Rng rng;
+	rng_seed(&rng, 42);
+	for (size_t i=0; i<actions.size(); i++)
+		actions[i] = rng_range(&rng, BATCH_NUM_ACTIONS);
+	vector<uint64_t> seeds(games);
+	for (int i=0; i<games; i++)
+		seeds[i] = i + 1;
+	vector<int32_t> obs(games), obs_ref(games);
+	vector<float> rewards(games), rewards_ref(games);
+	vector<uint8_t> done(games), done_ref(games);
+
+	BatchEnv env, ref;
+	batch_env_create(&env, games, 200, 12, 3);
+	batch_env_create(&ref, games, 200, 12, 3);
+	batch_env_reset(&env, &seeds[0], &obs[0]);
+	batch_env_reset(&ref, &seeds[0], &obs_ref[0]);
+	// The check also feeds actions out of 0..7, negative ones included,
+	// which both paths must decode the same way
+	vector<int32_t> wild(actions.size());
+	for (size_t i=0; i<wild.size(); i++)
+		wild[i] = actions[i] + BATCH_NUM_ACTIONS * (rng_range(&rng, 9) - 4);
+	for (int s=0; s<1000; s++)
+	{
+		const int32_t *a = &wild[(size_t)(s % action_sets) * games];
+		batch_env_step(&env, a, &obs[0], &rewards[0], &done[0]);
+		batch_env_step_scalar(&ref, a, &obs_ref[0], &rewards_ref[0], &done_ref[0]);
+		if (!same_state(&env, &ref) || obs != obs_ref || rewards != rewards_ref || done != done_ref)
+		{
+			fprintf(stderr, "Error: SIMD and scalar batches diverged at step %d\n", s);
+			return EXIT_FAILURE;
+		}
+	}
+	printf("SIMD and scalar paths agree over 1000 steps of %d games\n", games);
+	batch_env_destroy(&ref);
+	batch_env_destroy(&env);
+
+	// Equal shards, the first games % threads of them one game larger
+	vector<Shard> shards(threads);
+	int first = 0;
+	for (int t=0; t<threads; t++)
+	{
+		Shard &shard = shards[t];
+		shard.first = first;
+		shard.n = games / threads + (t < games % threads);
+		shard.actions = &actions;
+		shard.seeds = &seeds;
+		shard.action_sets = action_sets;
+		shard.games = games;
+		shard.steps = steps;
+		first += shard.n;
+	}
+	if (threads == 1)
+		run_shard(&shards[0]);
+	else
+	{
+		vector<thread> workers;
+		for (int t=0; t<threads; t++)
+			workers.push_back(thread(run_shard, &shards[t]));
+		for (int t=0; t<threads; t++)
+			workers[t].join();
+	}
+	// Wall time from the first shard starting to step to the last finishing
+	chrono::steady_clock::time_point start = shards[0].start, end = shards[0].end;
+	for (int t=1; t<threads; t++)
+	{
+		start = min(start, shards[t].start);
+		end = max(end, shards[t].end);
+	}
+	double secs = chrono::duration<double>(end - start).count();
+	printf("%lld game steps in %.2f s on %d thread%s (%.1f M steps/s)\n", steps * games, secs,
+			threads, threads > 1 ? "s" : "", steps * games / secs / 1e6);
+	return EXIT_SUCCESS;
+}
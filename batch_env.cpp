@@ -0,0 +1,273 @@
+#include <cstdlib>
+#include <cstring>
+
+#include "batch_env.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define BATCH_LANES 4 // SSE2 width in int32 lanes
+
+static_assert(BATCH_NUM_ACTIONS == 8, "actions are decoded as 2 direction bits and a jump bit");
+
+static int32_t* alloc_lanes (int count)
+{
+	size_t bytes = ((count * sizeof(int32_t) + 63) / 64) * 64;
+	int32_t *p = (int32_t*) aligned_alloc(64, bytes);
+	memset(p, 0, bytes);
+	return p;
+}
+
+void batch_env_create (BatchEnv *env, int n, int max_steps, int reshuffle, int lives)
+{
+	env->n = n;
+	env->stride = (n + BATCH_LANES - 1) / BATCH_LANES * BATCH_LANES;
+	env->max_steps = max_steps;
+	env->reshuffle = reshuffle;
+	env->lives = lives;
+
+	env->pos_x = alloc_lanes(env->stride);
+	env->pos_y = alloc_lanes(env->stride);
+	env->score = alloc_lanes(env->stride);
+	env->deaths = alloc_lanes(env->stride);
+	env->steps = alloc_lanes(env->stride);
+	env->shuffle_timer = alloc_lanes(env->stride);
+	env->result = alloc_lanes(env->stride);
+	env->holes = alloc_lanes(BOARD_SIZE * env->stride);
+	env->obstacles = alloc_lanes(BOARD_SIZE * env->stride);
+	env->moving = alloc_lanes(BOARD_SIZE * env->stride);
+	env->rng = new Rng[env->stride];
+	for (int e=0; e<env->stride; e++)
+		rng_seed(&env->rng[e], e);
+}
+
+void batch_env_destroy (BatchEnv *env)
+{
+	free(env->pos_x);
+	free(env->pos_y);
+	free(env->score);
+	free(env->deaths);
+	free(env->steps);
+	free(env->shuffle_timer);
+	free(env->result);
+	free(env->holes);
+	free(env->obstacles);
+	free(env->moving);
+	delete [] env->rng;
+}
+
+static void load_layout (const BatchEnv *env, int e, Layout *layout)
+{
+	for (int i=0; i<LAYOUT_SLOTS; i++)
+		layout->holes[i] = layout->obstacles[i] = layout->moving[i] = -1;
+	for (int c=0; c<BOARD_SIZE; c++)
+	{
+		layout->holes[c] = env->holes[c*env->stride + e];
+		layout->obstacles[c] = env->obstacles[c*env->stride + e];
+		layout->moving[c] = env->moving[c*env->stride + e];
+	}
+}
+
+static void store_layout (BatchEnv *env, int e, const Layout *layout)
+{
+	for (int c=0; c<BOARD_SIZE; c++)
+	{
+		env->holes[c*env->stride + e] = layout->holes[c];
+		env->obstacles[c*env->stride + e] = layout->obstacles[c];
+		env->moving[c*env->stride + e] = layout->moving[c];
+	}
+}
+
+static void reset_game (BatchEnv *env, int e)
+{
+	Layout layout;
+	layout_generate(&layout, &env->rng[e]);
+	store_layout(env, e, &layout);
+	env->pos_x[e] = 0;
+	env->pos_y[e] = 0;
+	env->score[e] = 0;
+	env->deaths[e] = 0;
+	env->steps[e] = 0;
+	env->shuffle_timer[e] = env->reshuffle;
+	env->result[e] = MOVE_NONE;
+}
+
+void batch_env_reset (BatchEnv *env, const uint64_t *seeds, int32_t *obs)
+{
+	for (int e=0; e<env->n; e++)
+	{
+		rng_seed(&env->rng[e], seeds[e]);
+		reset_game(env, e);
+		if (obs)
+			obs[e] = 0;
+	}
+}
+
+/* Timers, episode end and auto-reset for one game after its move */
+static uint8_t finish_step (BatchEnv *env, int e, int32_t *obs)
+{
+	if (env->reshuffle > 0 && --env->shuffle_timer[e] <= 0)
+	{
+		Layout layout;
+		load_layout(env, e, &layout);
+		layout_shuffle_obstacles(&layout, &env->rng[e]);
+		store_layout(env, e, &layout);
+		env->shuffle_timer[e] = env->reshuffle;
+	}
+	uint8_t done = env->result[e] == MOVE_WIN || env->steps[e] >= env->max_steps
+		|| (env->lives > 0 && env->deaths[e] >= env->lives);
+	if (done)
+		reset_game(env, e);
+	if (obs)
+		obs[e] = env->pos_x[e] | (env->pos_y[e] << 8);
+	return done;
+}
+
+static void step_one (BatchEnv *env, int e, int32_t action, int32_t *obs, float *rewards, uint8_t *done)
+{
+	Layout layout;
+	load_layout(env, e, &layout);
+	GameState s;
+	s.pos_x = env->pos_x[e];
+	s.pos_y = env->pos_y[e];
+	s.score = env->score[e];
+	s.deaths = env->deaths[e];
+	s.won = 0;
+
+	action &= BATCH_NUM_ACTIONS - 1;
+	Direction dir = (Direction)(action % NUM_DIRECTIONS);
+	MoveResult res = action < NUM_DIRECTIONS ? game_move(&s, &layout, dir) : game_jump(&s, &layout, dir);
+
+	rewards[e] = (float)(s.score - env->score[e]);
+	env->pos_x[e] = s.pos_x;
+	env->pos_y[e] = s.pos_y;
+	env->score[e] = s.score;
+	env->deaths[e] = s.deaths;
+	env->steps[e]++;
+	env->result[e] = res;
+	done[e] = finish_step(env, e, obs);
+}
+
+void batch_env_step_scalar (BatchEnv *env, const int32_t *actions, int32_t *obs, float *rewards, uint8_t *done)
+{
+	for (int e=0; e<env->n; e++)
+		step_one(env, e, actions[e], obs, rewards, done);
+}
+
+#ifdef __SSE2__
+void batch_env_step (BatchEnv *env, const int32_t *actions, int32_t *obs, float *rewards, uint8_t *done)
+{
+	const int stride = env->stride;
+	const int simd_n = env->n / BATCH_LANES * BATCH_LANES;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i one = _mm_set1_epi32(1);
+	const __m128i three = _mm_set1_epi32(3);
+	const __m128i four = _mm_set1_epi32(4);
+	const __m128i minus_one = _mm_set1_epi32(-1);
+	const __m128i board = _mm_set1_epi32(BOARD_SIZE);
+	const __m128i goal_x = _mm_set1_epi32(GOAL_X);
+	const __m128i goal_y = _mm_set1_epi32(GOAL_Y);
+	const __m128i penalty = _mm_set1_epi32(-DEATH_PENALTY);
+	const __m128i bonus = _mm_set1_epi32(WIN_BONUS);
+	const __m128i max_steps = _mm_set1_epi32(env->max_steps);
+	const __m128i lives = _mm_set1_epi32(env->lives > 0 ? env->lives : 0x7fffffff);
+	const __m128i timer_on = _mm_set1_epi32(env->reshuffle > 0 ? -1 : 0);
+
+	for (int e=0; e<simd_n; e+=BATCH_LANES)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i*)(actions + e));
+		__m128i px = _mm_load_si128((const __m128i*)(env->pos_x + e));
+		__m128i py = _mm_load_si128((const __m128i*)(env->pos_y + e));
+
+		// Direction and length from the action id (taken & 7, like
+		// step_one), as lane masks
+		__m128i dir = _mm_and_si128(a, three);
+		__m128i jump = _mm_cmpeq_epi32(_mm_and_si128(a, four), four);
+		__m128i dy = _mm_sub_epi32(_mm_cmpeq_epi32(dir, one), _mm_cmpeq_epi32(dir, zero));
+		__m128i dx = _mm_sub_epi32(_mm_cmpeq_epi32(dir, _mm_set1_epi32(DIR_LEFT)), _mm_cmpeq_epi32(dir, three));
+		dx = _mm_add_epi32(dx, _mm_and_si128(dx, jump));
+		dy = _mm_add_epi32(dy, _mm_and_si128(dy, jump));
+		__m128i tx = _mm_add_epi32(px, dx);
+		__m128i ty = _mm_add_epi32(py, dy);
+
+		__m128i on_board = _mm_and_si128(
+				_mm_and_si128(_mm_cmpgt_epi32(tx, minus_one), _mm_cmplt_epi32(tx, board)),
+				_mm_and_si128(_mm_cmpgt_epi32(ty, minus_one), _mm_cmplt_epi32(ty, board)));
+
+		// Select the target column by comparing against every column index:
+		// BOARD_SIZE contiguous loads instead of a per-lane gather
+		__m128i hit_o = zero, hit_h = zero, hit_m = zero;
+		for (int c=0; c<BOARD_SIZE; c++)
+		{
+			__m128i col = _mm_cmpeq_epi32(tx, _mm_set1_epi32(c));
+			__m128i o = _mm_load_si128((const __m128i*)(env->obstacles + c*stride + e));
+			__m128i h = _mm_load_si128((const __m128i*)(env->holes + c*stride + e));
+			__m128i m = _mm_load_si128((const __m128i*)(env->moving + c*stride + e));
+			hit_o = _mm_or_si128(hit_o, _mm_and_si128(col, _mm_cmpeq_epi32(o, ty)));
+			hit_h = _mm_or_si128(hit_h, _mm_and_si128(col, _mm_cmpeq_epi32(h, ty)));
+			hit_m = _mm_or_si128(hit_m, _mm_and_si128(col, _mm_cmpeq_epi32(m, ty)));
+		}
+		hit_m = _mm_andnot_si128(jump, hit_m); // moving tiles can be jumped over
+
+		// Cause priority matches game_move: obstacle, hole, moving tile
+		__m128i dead_o = _mm_and_si128(on_board, hit_o);
+		__m128i dead_h = _mm_andnot_si128(hit_o, _mm_and_si128(on_board, hit_h));
+		__m128i dead_m = _mm_andnot_si128(_mm_or_si128(hit_o, hit_h), _mm_and_si128(on_board, hit_m));
+		__m128i dead = _mm_or_si128(dead_o, _mm_or_si128(dead_h, dead_m));
+		__m128i moved = _mm_andnot_si128(dead, on_board);
+		__m128i win = _mm_and_si128(moved, _mm_and_si128(_mm_cmpeq_epi32(tx, goal_x), _mm_cmpeq_epi32(ty, goal_y)));
+
+		// Off the board keeps the position, death resets it to (0,0)
+		px = _mm_or_si128(_mm_and_si128(moved, tx), _mm_andnot_si128(on_board, px));
+		py = _mm_or_si128(_mm_and_si128(moved, ty), _mm_andnot_si128(on_board, py));
+		_mm_store_si128((__m128i*)(env->pos_x + e), px);
+		_mm_store_si128((__m128i*)(env->pos_y + e), py);
+
+		__m128i reward = _mm_or_si128(_mm_and_si128(dead, penalty), _mm_and_si128(win, bonus));
+		__m128i score = _mm_add_epi32(_mm_load_si128((const __m128i*)(env->score + e)), reward);
+		__m128i deaths = _mm_sub_epi32(_mm_load_si128((const __m128i*)(env->deaths + e)), dead);
+		__m128i steps = _mm_add_epi32(_mm_load_si128((const __m128i*)(env->steps + e)), one);
+		__m128i timer = _mm_add_epi32(_mm_load_si128((const __m128i*)(env->shuffle_timer + e)), timer_on);
+		_mm_store_si128((__m128i*)(env->score + e), score);
+		_mm_store_si128((__m128i*)(env->deaths + e), deaths);
+		_mm_store_si128((__m128i*)(env->steps + e), steps);
+		_mm_store_si128((__m128i*)(env->shuffle_timer + e), timer);
+		_mm_storeu_ps(rewards + e, _mm_cvtepi32_ps(reward));
+
+		__m128i result = _mm_or_si128(
+				_mm_or_si128(_mm_and_si128(moved, _mm_set1_epi32(MOVE_OK)), _mm_and_si128(win, _mm_set1_epi32(MOVE_WIN))),
+				_mm_or_si128(_mm_and_si128(dead_o, _mm_set1_epi32(MOVE_DEATH_OBSTACLE)),
+					_mm_or_si128(_mm_and_si128(dead_h, _mm_set1_epi32(MOVE_DEATH_HOLE)),
+						_mm_and_si128(dead_m, _mm_set1_epi32(MOVE_DEATH_MOVING)))));
+		_mm_store_si128((__m128i*)(env->result + e), result);
+
+		__m128i finished = _mm_or_si128(win, _mm_or_si128(_mm_cmpgt_epi32(steps, _mm_sub_epi32(max_steps, one)),
+					_mm_cmpgt_epi32(deaths, _mm_sub_epi32(lives, one))));
+		__m128i reshuffle = _mm_and_si128(timer_on, _mm_cmpgt_epi32(one, timer));
+		if (obs)
+			_mm_storeu_si128((__m128i*)(obs + e), _mm_or_si128(px, _mm_slli_epi32(py, 8)));
+
+		int fix = _mm_movemask_ps(_mm_castsi128_ps(_mm_or_si128(finished, reshuffle)));
+		int fin = _mm_movemask_ps(_mm_castsi128_ps(finished));
+		for (int l=0; l<BATCH_LANES; l++)
+			done[e+l] = (fin >> l) & 1;
+		// Rare per-game work (reshuffles, resets) falls back to scalar code
+		while (fix)
+		{
+			int l = __builtin_ctz(fix);
+			fix &= fix - 1;
+			if (env->reshuffle > 0)
+				env->shuffle_timer[e+l]++; // finish_step decrements it again
+			done[e+l] = finish_step(env, e+l, obs);
+		}
+	}
+	for (int e=simd_n; e<env->n; e++)
+		step_one(env, e, actions[e], obs, rewards, done);
+}
+#else
+void batch_env_step (BatchEnv *env, const int32_t *actions, int32_t *obs, float *rewards, uint8_t *done)
+{
+	batch_env_step_scalar(env, actions, obs, rewards, done);
+}
+#endif
@@ -0,0 +1,55 @@
+#ifndef BATCH_ENV_H
+#define BATCH_ENV_H
+
+#include <stdint.h>
+
+#include "game_logic.h"
+
+/* Structure-of-arrays batch of independent games for agent training.
+ *
+ * Every per-game quantity is a parallel array indexed by game, and the
+ * layouts are stored column-major ([column*stride + game]) so the move and
+ * collision rules can run over SIMD lanes of games without gathers.
+ *
+ * Actions: 0..3 move one tile in Direction, 4..7 jump two tiles. Other
+ * values are taken modulo BATCH_NUM_ACTIONS (action & 7, so -1 is 7), the
+ * same way by the SIMD and the scalar path.
+ * Observation: pos_x | pos_y << 8; the layout arrays are public, so an
+ * agent may read the board directly (the game is fully observable).
+ * Games that finish (win, step limit or out of lives) are reset with a
+ * fresh layout inside step(), and the observation returned is the new one.
+ */
+
+#define BATCH_NUM_ACTIONS (2*NUM_DIRECTIONS)
+
+struct BatchEnv {
+	int n;          // number of games
+	int stride;     // n rounded up to the SIMD width, length of every array
+	int max_steps;  // episode length limit
+	int reshuffle;  // steps between obstacle reshuffles, 0 = never
+	int lives;      // deaths that end an episode, 0 = unlimited
+
+	int32_t *pos_x, *pos_y;
+	int32_t *score, *deaths;
+	int32_t *steps;         // steps taken this episode
+	int32_t *shuffle_timer; // steps left before the next obstacle reshuffle
+	int32_t *result;        // MoveResult of the last step
+	int32_t *holes, *obstacles, *moving;
+	Rng *rng;
+};
+
+void batch_env_create (BatchEnv *env, int n, int max_steps, int reshuffle, int lives);
+void batch_env_destroy (BatchEnv *env);
+
+/* Start every game over with the layout generated from seeds[i] */
+void batch_env_reset (BatchEnv *env, const uint64_t *seeds, int32_t *obs);
+
+/* Advance every game by one action; rewards are -10 for a death and +100
+   for a win, matching the game's score */
+void batch_env_step (BatchEnv *env, const int32_t *actions, int32_t *obs, float *rewards, uint8_t *done);
+
+/* Same as batch_env_step but one game at a time through game_logic; used
+   as the reference for the SIMD path */
+void batch_env_step_scalar (BatchEnv *env, const int32_t *actions, int32_t *obs, float *rewards, uint8_t *done);
+
+#endif
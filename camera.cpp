@@ -0,0 +1,137 @@
+#include <cmath>
+#include <cstring>
+
+#include "camera.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+const char *camera_mode_names[NUM_CAMERA_MODES] = { "tower", "top", "player", "follow", "helicopter" };
+
+int camera_mode_from_name (const char *name)
+{
+	for (int mode=0; mode<NUM_CAMERA_MODES; mode++)
+		if (!strcmp(name, camera_mode_names[mode]))
+			return mode;
+	return -1;
+}
+
+// GLM_FORCE_RADIANS is set, so this is 90 radians; it is the field of view
+// the game has always had and the golden images are made with it
+#define CAMERA_FOV 90.0f
+#define CAMERA_NEAR 1.0f
+#define CAMERA_FAR 500.0f
+#define ORBIT_RADIUS 10.0f
+
+CameraPose camera_pose (CameraMode mode, float angle_offset, float zoom, float drag_angle,
+		float player_x, float player_y)
+{
+	CameraPose pose;
+	pose.target = glm::vec3(5, 5, 0); // middle of the board
+	pose.up = glm::vec3(0, 0, 1);
+	float angle = angle_offset;
+	switch (mode) {
+		case CAMERA_TOWER:
+		case CAMERA_HELICOPTER:
+			angle += mode == CAMERA_TOWER ? 120 : 45 + drag_angle;
+			angle *= (float) M_PI / 180.0f;
+			pose.eye = glm::vec3(ORBIT_RADIUS * cosf(angle), -ORBIT_RADIUS * sinf(angle), 7);
+			break;
+		case CAMERA_TOP:
+			pose.eye = glm::vec3(5, 5, 7);
+			pose.up = glm::vec3(0, 1, 0);
+			break;
+		case CAMERA_PLAYER:
+			pose.eye = glm::vec3(player_x, player_y, 3);
+			pose.target = glm::vec3(player_x, player_y + 1, 3);
+			break;
+		case CAMERA_FOLLOW:
+		default:
+			pose.eye = glm::vec3(player_x, player_y - 3, 4);
+			pose.target = glm::vec3(player_x, player_y, 4);
+			break;
+	}
+	pose.eye.z += zoom;
+	return pose;
+}
+
+Camera::Camera ()
+	: updates(0), aspect_(0), view_dirty_(true), vp_dirty_(true), frustum_dirty_(true)
+{
+	pose_ = camera_pose(CAMERA_TOWER, 0, 0, 0, 0, 0);
+	set_aspect(1, 1);
+}
+
+void Camera::set_aspect (int width, int height)
+{
+	if (width <= 0 || height <= 0)
+		return;
+	float aspect = (float) width / (float) height;
+	if (aspect == aspect_)
+		return;
+	aspect_ = aspect;
+	projection_ = glm::perspective(CAMERA_FOV, aspect, CAMERA_NEAR, CAMERA_FAR);
+	vp_dirty_ = frustum_dirty_ = true;
+}
+
+void Camera::set_pose (const CameraPose &pose)
+{
+	if (pose.eye == pose_.eye && pose.target == pose_.target && pose.up == pose_.up)
+		return;
+	pose_ = pose;
+	view_dirty_ = vp_dirty_ = frustum_dirty_ = true;
+}
+
+const glm::mat4 &Camera::view ()
+{
+	if (view_dirty_)
+	{
+		view_ = glm::lookAt(pose_.eye, pose_.target, pose_.up);
+		view_dirty_ = false;
+	}
+	return view_;
+}
+
+const glm::mat4 &Camera::view_projection ()
+{
+	if (vp_dirty_)
+	{
+		vp_ = projection_ * view();
+		vp_dirty_ = false;
+		updates++;
+	}
+	return vp_;
+}
+
+/* Gribb and Hartmann: each plane is the last row of VP plus or minus
+   one of the others, for clip space -w <= x, y, z <= w */
+const glm::vec4 *Camera::frustum ()
+{
+	if (frustum_dirty_)
+	{
+		const glm::mat4 &m = view_projection();
+		glm::vec4 row[4];
+		for (int r=0; r<4; r++)
+			row[r] = glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+		for (int p=0; p<6; p++)
+		{
+			glm::vec4 plane = p % 2 ? row[3] - row[p / 2] : row[3] + row[p / 2];
+			planes_[p] = plane / glm::length(glm::vec3(plane));
+		}
+		frustum_dirty_ = false;
+	}
+	return planes_;
+}
+
+bool Camera::box_visible (const glm::vec3 &min, const glm::vec3 &max)
+{
+	const glm::vec4 *planes = frustum();
+	for (int p=0; p<6; p++)
+	{
+		// The corner furthest along the plane normal
+		glm::vec3 corner(planes[p].x >= 0 ? max.x : min.x, planes[p].y >= 0 ? max.y : min.y,
+				planes[p].z >= 0 ? max.z : min.z);
+		if (glm::dot(glm::vec3(planes[p]), corner) + planes[p].w < 0)
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,72 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+/* The game's cameras, in float.
+ *
+ * camera_pose() turns a mode and the input state (scroll, drag, player
+ * position) into eye, target and up. A Camera holds one pose and the
+ * projection and caches what derives from them: view, projection * view
+ * and the six frustum planes are recomputed on first use after a change,
+ * so a camera that didn't move costs nothing per frame.
+ *
+ *   camera.set_aspect(width, height);          // reshapeWindow
+ *   camera.set_pose(camera_pose(...));         // every frame, cheap if unchanged
+ *   glm::mat4 VP = camera.view_projection();
+ *   if (camera.box_visible(min, max)) ...
+ */
+
+enum CameraMode {
+	CAMERA_TOWER,      // fixed orbit corner (O)
+	CAMERA_TOP,        // straight down (T)
+	CAMERA_PLAYER,     // from the player, looking ahead (P)
+	CAMERA_FOLLOW,     // behind and above the player (C)
+	CAMERA_HELICOPTER, // orbit dragged with the mouse (H)
+	NUM_CAMERA_MODES
+};
+
+extern const char *camera_mode_names[NUM_CAMERA_MODES];
+
+/* Mode from its name in camera_mode_names, or -1 */
+int camera_mode_from_name (const char *name);
+
+struct CameraPose {
+	glm::vec3 eye, target, up;
+};
+
+/* angle_offset and drag_angle in degrees, zoom raises the eye */
+CameraPose camera_pose (CameraMode mode, float angle_offset, float zoom, float drag_angle,
+		float player_x, float player_y);
+
+class Camera
+{
+	public:
+	Camera ();
+
+	/* Projection for a viewport of this size; ignores empty viewports */
+	void set_aspect (int width, int height);
+	void set_pose (const CameraPose &pose);
+
+	const glm::mat4 &view ();
+	const glm::mat4 &projection () { return projection_; }
+	const glm::mat4 &view_projection ();
+	/* Planes as (normal, d), normal pointing inside, normalised:
+	   left, right, bottom, top, near, far */
+	const glm::vec4 *frustum ();
+
+	/* Conservative: false only if the box is entirely outside a plane */
+	bool box_visible (const glm::vec3 &min, const glm::vec3 &max);
+
+	int updates;        // times view/VP were recomputed, for reports
+
+	private:
+	CameraPose pose_;
+	float aspect_;
+	glm::mat4 view_, projection_, vp_;
+	glm::vec4 planes_[6];
+	bool view_dirty_, vp_dirty_, frustum_dirty_;
+};
+
+#endif
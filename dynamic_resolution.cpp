@@ -0,0 +1,140 @@
+#include <cmath>
+#include <algorithm>
+
+#include "dynamic_resolution.h"
+#include "log.h"
+
+using namespace std;
+
+void dynres_create (DynamicResolution *dr, double target_ms, float min_scale, float max_scale, float hysteresis)
+{
+	dr->target = target_ms / 1000;
+	dr->max_scale = max_scale > 0 ? max_scale : 1;
+	dr->min_scale = min(max(min_scale, 0.05f), dr->max_scale);
+	dr->hysteresis = hysteresis;
+	dr->scale = dr->max_scale;
+	dr->width = dr->height = 0;
+	dr->render_width = dr->render_height = 0;
+	dr->target_width = dr->target_height = 0;
+	dr->framebuffer = GpuFramebuffer::create();
+	dr->color = GpuRenderbuffer::create();
+	dr->depth = GpuRenderbuffer::create();
+	for (int i=0; i<DYNRES_QUERIES; i++) {
+		dr->queries[i] = GpuQuery::create();
+		dr->pending[i] = false;
+	}
+	dr->query = 0;
+	dr->gpu_time = 0;
+	dr->cooldown = 0;
+	dr->frames = dr->changes = 0;
+	dr->scale_total = 0;
+}
+
+void dynres_destroy (DynamicResolution *dr)
+{
+	dr->framebuffer.reset();
+	dr->color.reset();
+	dr->depth.reset();
+	for (int i=0; i<DYNRES_QUERIES; i++)
+		dr->queries[i].reset();
+}
+
+/* (Re)allocate the target for a width x height window at max_scale */
+static void resize_target (DynamicResolution *dr, int width, int height)
+{
+	dr->width = width;
+	dr->height = height;
+	dr->target_width = max(1, (int) ceilf(width * dr->max_scale));
+	dr->target_height = max(1, (int) ceilf(height * dr->max_scale));
+	gpu_renderbuffer_storage(dr->color, GL_RGBA8, dr->target_width, dr->target_height, 4);
+	gpu_renderbuffer_storage(dr->depth, GL_DEPTH_COMPONENT24, dr->target_width, dr->target_height, 4);
+	glBindFramebuffer(GL_FRAMEBUFFER, dr->framebuffer.get());
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, dr->color.get());
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, dr->depth.get());
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		LOG(LOG_ERROR, "dynamic resolution target %dx%d is incomplete", dr->target_width, dr->target_height);
+}
+
+/* Fold finished timer queries into gpu_time, oldest first */
+static void read_queries (DynamicResolution *dr)
+{
+	for (int k=0; k<DYNRES_QUERIES; k++) {
+		int i = (dr->query + k) % DYNRES_QUERIES;
+		if (!dr->pending[i])
+			continue;
+		GLint available = 0;
+		glGetQueryObjectiv(dr->queries[i].get(), GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			break;
+		GLuint64 ns = 0;
+		glGetQueryObjectui64v(dr->queries[i].get(), GL_QUERY_RESULT, &ns);
+		dr->pending[i] = false;
+		double time = ns * 1e-9;
+		dr->gpu_time = dr->gpu_time > 0 ? dr->gpu_time + DYNRES_SMOOTHING * (time - dr->gpu_time) : time;
+		if (dr->cooldown > 0)
+			dr->cooldown--;
+	}
+}
+
+static void adjust_scale (DynamicResolution *dr)
+{
+	if (dr->gpu_time <= 0 || dr->cooldown > 0)
+		return;
+	if (dr->gpu_time <= dr->target * (1 + dr->hysteresis) && dr->gpu_time >= dr->target * (1 - dr->hysteresis))
+		return;
+	float wanted = dr->scale * sqrtf((float) (dr->target / dr->gpu_time));
+	wanted = min(max(wanted, dr->scale * (1 - DYNRES_MAX_STEP)), dr->scale * (1 + DYNRES_MAX_STEP));
+	wanted = min(max(wanted, dr->min_scale), dr->max_scale);
+	if (fabsf(wanted - dr->scale) < 0.01f)
+		return;
+	LOG(LOG_DEBUG, "resolution scale %.2f -> %.2f, GPU %.2f ms for %.2f ms", dr->scale, wanted,
+			1000 * dr->gpu_time, 1000 * dr->target);
+	dr->scale = wanted;
+	dr->cooldown = DYNRES_COOLDOWN;
+	dr->changes++;
+}
+
+void dynres_begin (DynamicResolution *dr, int width, int height)
+{
+	if (width != dr->width || height != dr->height)
+		resize_target(dr, width, height);
+	read_queries(dr);
+	adjust_scale(dr);
+
+	dr->render_width = min(dr->target_width, max(1, (int) (width * dr->scale + 0.5f)));
+	dr->render_height = min(dr->target_height, max(1, (int) (height * dr->scale + 0.5f)));
+	glBindFramebuffer(GL_FRAMEBUFFER, dr->framebuffer.get());
+	// The target is larger than what this frame uses; keep the clear to it
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(0, 0, dr->render_width, dr->render_height);
+
+	// A query still in flight from DYNRES_QUERIES frames ago is dropped
+	// rather than waited for
+	dr->pending[dr->query] = false;
+	glBeginQuery(GL_TIME_ELAPSED, dr->queries[dr->query].get());
+}
+
+void dynres_end (DynamicResolution *dr)
+{
+	glEndQuery(GL_TIME_ELAPSED);
+	dr->pending[dr->query] = true;
+	dr->query = (dr->query + 1) % DYNRES_QUERIES;
+
+	glDisable(GL_SCISSOR_TEST); // it applies to blits too
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, dr->framebuffer.get());
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, dr->render_width, dr->render_height, 0, 0, dr->width, dr->height,
+			GL_COLOR_BUFFER_BIT, dr->render_width == dr->width && dr->render_height == dr->height ? GL_NEAREST : GL_LINEAR);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	dr->frames++;
+	dr->scale_total += dr->scale;
+}
+
+void dynres_report (const DynamicResolution *dr, FILE *fp)
+{
+	if (dr->frames == 0)
+		return;
+	fprintf(fp, "RESOLUTION: scale %.2f now, %.2f mean, %ld changes, GPU %.2f ms for a %.2f ms target\n",
+			dr->scale, dr->scale_total / dr->frames, dr->changes, 1000 * dr->gpu_time, 1000 * dr->target);
+}
@@ -0,0 +1,63 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <stdio.h>
+#include <glad/glad.h>
+
+#include "gpu_handle.h"
+
+/* Render the scene at a fraction of the window's resolution, chosen each
+ * frame from the measured GPU time, and stretch it to the window.
+ *
+ * The offscreen colour and depth target is allocated at max_scale times the
+ * window size and only reallocated when the window changes; a scale change
+ * just uses less of it. draw() is bracketed by a GL_TIME_ELAPSED query;
+ * results are read DYNRES_QUERIES frames later so the CPU never waits on
+ * them. When the smoothed GPU time is outside target * (1 +- hysteresis),
+ * the scale moves toward sqrt(target / time) (pixel cost goes with the
+ * square of the scale), by at most DYNRES_MAX_STEP, and then stays put for
+ * DYNRES_COOLDOWN frames so the next measurement reflects the change.
+ *
+ *   dynres_begin(&dr, fb_width, fb_height); // binds the target, scissored
+ *   draw(...);                              // to dr.render_width x dr.render_height
+ *   dynres_end(&dr);                        // one linear blit to the window
+ */
+
+#define DYNRES_QUERIES 4
+#define DYNRES_COOLDOWN 8
+#define DYNRES_MAX_STEP 0.1f    // largest relative scale change at once
+#define DYNRES_SMOOTHING 0.25   // weight of the newest GPU time in the average
+
+struct DynamicResolution {
+	double target;              // GPU seconds per frame to aim for
+	float min_scale, max_scale;
+	float hysteresis;           // fraction of target where the scale is left alone
+
+	float scale;
+	int width, height;          // window framebuffer
+	int render_width, render_height; // this frame's part of the target
+	GpuFramebuffer framebuffer;
+	GpuRenderbuffer color, depth;
+	int target_width, target_height;
+
+	GpuQuery queries[DYNRES_QUERIES];
+	bool pending[DYNRES_QUERIES];
+	int query;                  // the one this frame uses
+	double gpu_time;            // smoothed, seconds; 0 before the first result
+	int cooldown;
+
+	long frames, changes;
+	double scale_total;
+};
+
+void dynres_create (DynamicResolution *dr, double target_ms, float min_scale, float max_scale, float hysteresis);
+void dynres_destroy (DynamicResolution *dr);
+
+/* Bind the target for a frame in a width x height window */
+void dynres_begin (DynamicResolution *dr, int width, int height);
+/* Stop timing and blit to the default framebuffer, which is left bound */
+void dynres_end (DynamicResolution *dr);
+
+void dynres_report (const DynamicResolution *dr, FILE *fp);
+
+#endif
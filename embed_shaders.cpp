@@ -0,0 +1,98 @@
+/* Build step: embed shader sources into the binary
+ *
+ *   ./embed_shaders shaders_embedded.h Sample_GL.vert Sample_GL.frag ...
+ *
+ * Writes a header with one ShaderSource entry per file (name, source as a
+ * string literal, length and FNV-1a hash computed here), so the game
+ * starts without reading any shader file.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "hash.h"
+
+using namespace std;
+
+static bool read_file (const char *path, string *out)
+{
+	FILE *fp = fopen(path, "rb");
+	if (!fp)
+		return false;
+	char buf[4096];
+	size_t n;
+	while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+		out->append(buf, n);
+	bool ok = !ferror(fp);
+	fclose(fp);
+	return ok;
+}
+
+/* Registry name: the file name without directories */
+static const char* base_name (const char *path)
+{
+	const char *slash = strrchr(path, '/');
+	return slash ? slash + 1 : path;
+}
+
+static void write_literal (FILE *out, const string &code)
+{
+	fputs("\t\t\"", out);
+	for (size_t i=0; i<code.size(); i++)
+	{
+		unsigned char ch = code[i];
+		if (ch == '\n')
+			fputs(i + 1 < code.size() ? "\\n\"\n\t\t\"" : "\\n", out);
+		else if (ch == '"' || ch == '\\')
+			fprintf(out, "\\%c", ch);
+		else if (ch < 0x20 || ch >= 0x7f)
+			fprintf(out, "\\%03o", ch);
+		else
+			fputc(ch, out);
+	}
+	fputs("\"", out);
+}
+
+int main (int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		fprintf(stderr, "usage: %s OUTPUT.h SHADER...\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	string tmp = string(argv[1]) + ".tmp";
+	FILE *out = fopen(tmp.c_str(), "w");
+	if (!out)
+	{
+		fprintf(stderr, "Error: cannot write %s\n", tmp.c_str());
+		return EXIT_FAILURE;
+	}
+	fprintf(out, "/* Generated by embed_shaders - do not edit */\n\n");
+	fprintf(out, "#ifndef SHADERS_EMBEDDED_H\n#define SHADERS_EMBEDDED_H\n\n");
+	fprintf(out, "static constexpr ShaderSource embedded_shaders[] = {\n");
+	for (int i=2; i<argc; i++)
+	{
+		string code;
+		if (!read_file(argv[i], &code))
+		{
+			fprintf(stderr, "Error: cannot read shader %s\n", argv[i]);
+			fclose(out);
+			remove(tmp.c_str());
+			return EXIT_FAILURE;
+		}
+		fprintf(out, "\t{ \"%s\",\n", base_name(argv[i]));
+		write_literal(out, code);
+		fprintf(out, ",\n\t\t%lu, 0x%016llxULL },\n", (unsigned long) code.size(),
+				(unsigned long long) hash_bytes(code.data(), code.size()));
+	}
+	fprintf(out, "};\n\n#endif\n");
+	if (fclose(out) != 0 || rename(tmp.c_str(), argv[1]) != 0)
+	{
+		fprintf(stderr, "Error: cannot write %s\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
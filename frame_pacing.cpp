@@ -0,0 +1,123 @@
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "frame_pacing.h"
+#include "log.h"
+
+using namespace std;
+
+const char *pacing_mode_names[NUM_PACING_MODES] = { "vsync", "adaptive", "uncapped", "cap" };
+
+int pacing_mode_from_name (const char *name)
+{
+	for (int mode=0; mode<NUM_PACING_MODES; mode++)
+		if (!strcmp(name, pacing_mode_names[mode]))
+			return mode;
+	return -1;
+}
+
+static double seconds (PacingTime from, PacingTime to)
+{
+	return chrono::duration<double>(to - from).count();
+}
+
+/* Forget the last present: the next one starts the interval statistics */
+static void pacing_restart (FramePacer *pacer)
+{
+	pacer->last_present = PacingTime();
+	pacer->deadline = chrono::steady_clock::now();
+}
+
+void pacing_init (FramePacer *pacer, GLFWwindow *window, PacingMode mode, double cap_hz)
+{
+	pacer->mode = mode;
+	pacer->frames = pacer->missed = 0;
+	pacer->total_interval = pacer->max_interval = pacer->spin_time = 0;
+
+	// The display's frame period, for the vsync modes
+	pacer->period = 0;
+	const GLFWvidmode *video = glfwGetVideoMode(glfwGetPrimaryMonitor());
+	if (video && video->refreshRate > 0)
+		pacer->period = 1.0 / video->refreshRate;
+
+	int interval = 1;
+	if (mode == PACING_ADAPTIVE) {
+		if (glfwExtensionSupported("GLX_EXT_swap_control_tear") || glfwExtensionSupported("WGL_EXT_swap_control_tear"))
+			interval = -1;
+		else {
+			LOG(LOG_WARN, "adaptive vsync not supported, using vsync");
+			pacer->mode = PACING_VSYNC;
+		}
+	}
+	else if (mode == PACING_UNCAPPED) {
+		interval = 0;
+		pacer->period = 0;
+	}
+	else if (mode == PACING_CAP) {
+		interval = 0;
+		pacer->period = cap_hz > 0 ? 1.0 / cap_hz : 0;
+	}
+	glfwMakeContextCurrent(window);
+	glfwSwapInterval(interval);
+	pacing_restart(pacer);
+}
+
+void pacing_wait (FramePacer *pacer)
+{
+	if (pacer->mode != PACING_CAP || pacer->period <= 0)
+		return;
+	PacingTime now = chrono::steady_clock::now();
+	double left = seconds(now, pacer->deadline);
+	if (left > PACING_SPIN)
+		this_thread::sleep_for(chrono::duration<double>(left - PACING_SPIN));
+	PacingTime spin_start = chrono::steady_clock::now();
+	while (chrono::steady_clock::now() < pacer->deadline)
+		;
+	pacer->spin_time += seconds(spin_start, chrono::steady_clock::now());
+}
+
+void pacing_presented (FramePacer *pacer)
+{
+	PacingTime now = chrono::steady_clock::now();
+	if (pacer->last_present != PacingTime()) {
+		double interval = seconds(pacer->last_present, now);
+		pacer->intervals[pacer->frames % PACING_HISTORY] = interval;
+		pacer->total_interval += interval;
+		pacer->max_interval = max(pacer->max_interval, interval);
+		pacer->frames++;
+		if (pacer->period > 0 && interval > 1.5 * pacer->period) {
+			pacer->missed++;
+			LOG(LOG_DEBUG, "missed frame: %.2f ms, period %.2f ms", 1000 * interval, 1000 * pacer->period);
+		}
+	}
+	pacer->last_present = now;
+
+	if (pacer->mode == PACING_CAP && pacer->period > 0) {
+		// The next deadline is one period on; after a late frame, one
+		// period after this present rather than rushing frames to catch up
+		PacingTime::duration period = chrono::duration_cast<PacingTime::duration>(chrono::duration<double>(pacer->period));
+		pacer->deadline += period;
+		if (pacer->deadline < now)
+			pacer->deadline = now + period;
+	}
+}
+
+void pacing_report (const FramePacer *pacer, FILE *fp)
+{
+	if (pacer->frames == 0)
+		return;
+	long kept = min(pacer->frames, (long) PACING_HISTORY);
+	vector<float> sorted(pacer->intervals, pacer->intervals + kept);
+	sort(sorted.begin(), sorted.end());
+	fprintf(fp, "PACING: %s, %ld frames, interval mean %.2f ms, p50 %.2f ms, p99 %.2f ms, max %.2f ms, %ld missed (%.1f%%)",
+			pacing_mode_names[pacer->mode], pacer->frames, 1000 * pacer->total_interval / pacer->frames,
+			1000 * sorted[kept / 2], 1000 * sorted[(kept * 99) / 100], 1000 * pacer->max_interval,
+			pacer->missed, 100.0 * pacer->missed / pacer->frames);
+	if (pacer->mode == PACING_CAP)
+		fprintf(fp, ", %.1f ms spinning per frame", 1000 * pacer->spin_time / pacer->frames);
+	fprintf(fp, "\n");
+}
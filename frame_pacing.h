@@ -0,0 +1,62 @@
+#ifndef FRAME_PACING_H
+#define FRAME_PACING_H
+
+#include <stdio.h>
+#include <chrono>
+
+struct GLFWwindow;
+
+/* When frames are presented, and how evenly.
+ *
+ * PACING_VSYNC      swap interval 1: wait for every vblank
+ * PACING_ADAPTIVE   swap interval -1 (EXT_swap_control_tear): vsync, but a
+ *                   late frame tears instead of waiting a whole vblank;
+ *                   plain vsync if the driver lacks it
+ * PACING_UNCAPPED   swap interval 0, as fast as possible (benchmarks)
+ * PACING_CAP        swap interval 0, held to cap_hz: sleep until just before
+ *                   the deadline, then spin the last PACING_SPIN seconds,
+ *                   since sleeps overshoot by up to a scheduler tick
+ *
+ * Every present is timestamped; an interval longer than 1.5 frame periods
+ * (refresh rate, or the cap) counts as a missed deadline.
+ *
+ *   pacing_init(&pacer, window, PACING_CAP, 144);
+ *   ...draw...
+ *   pacing_wait(&pacer);         // PACING_CAP only, no-op otherwise
+ *   glfwSwapBuffers(window);
+ *   pacing_presented(&pacer);
+ */
+
+enum PacingMode { PACING_VSYNC, PACING_ADAPTIVE, PACING_UNCAPPED, PACING_CAP, NUM_PACING_MODES };
+
+extern const char *pacing_mode_names[NUM_PACING_MODES];
+
+#define PACING_SPIN 0.002
+#define PACING_HISTORY 4096     // intervals kept for the percentiles in the report
+
+typedef std::chrono::steady_clock::time_point PacingTime;
+
+struct FramePacer {
+	PacingMode mode;
+	double period;            // seconds per frame the deadline is based on, 0 if unknown
+	PacingTime deadline;      // PACING_CAP: when the next present should happen
+	PacingTime last_present;
+
+	long frames;
+	long missed;
+	double total_interval;
+	double max_interval;      // whole run, not just the kept history
+	float intervals[PACING_HISTORY]; // seconds, ring
+	double spin_time;         // seconds spent spinning in pacing_wait
+};
+
+/* Sets the swap interval for mode; cap_hz is only used by PACING_CAP */
+void pacing_init (FramePacer *pacer, GLFWwindow *window, PacingMode mode, double cap_hz);
+void pacing_wait (FramePacer *pacer);
+void pacing_presented (FramePacer *pacer);
+void pacing_report (const FramePacer *pacer, FILE *fp);
+
+/* Mode from its name in pacing_mode_names, or -1 */
+int pacing_mode_from_name (const char *name);
+
+#endif
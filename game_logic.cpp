@@ -0,0 +1,123 @@
+#include "game_logic.h"
+
+void rng_seed (Rng *rng, uint64_t seed)
+{
+	rng->s = seed;
+}
+
+uint64_t rng_next (Rng *rng)
+{
+	uint64_t z = (rng->s += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+int rng_range (Rng *rng, int n)
+{
+	// multiply-shift instead of modulo: no bias worth caring about for tiny n
+	return (int)(((rng_next(rng) >> 32) * (uint64_t)n) >> 32);
+}
+
+void layout_generate (Layout *layout, Rng *rng)
+{
+	for (int i=0; i<LAYOUT_SLOTS; i++)
+	{
+		layout->holes[i] = -1;
+		layout->obstacles[i] = -1;
+		layout->moving[i] = -1;
+	}
+	for (int i=0; i<BOARD_SIZE; i++)
+	{
+		layout->holes[i] = rng_range(rng, 11) + 1;
+		layout->moving[i] = rng_range(rng, 11) + 1;
+	}
+	layout_shuffle_obstacles(layout, rng);
+}
+
+void layout_shuffle_obstacles (Layout *layout, Rng *rng)
+{
+	for (int i=0; i<BOARD_SIZE; i++)
+		layout->obstacles[i] = rng_range(rng, 11) + 1;
+}
+
+void layout_from_seed (Layout *layout, uint64_t seed)
+{
+	Rng rng;
+	rng_seed(&rng, seed);
+	layout_generate(layout, &rng);
+}
+
+void game_reset (GameState *state)
+{
+	state->pos_x = 0;
+	state->pos_y = 0;
+	state->score = 0;
+	state->deaths = 0;
+	state->won = 0;
+}
+
+static const int dir_dx[NUM_DIRECTIONS] = { 0, 0, -1, 1 };
+static const int dir_dy[NUM_DIRECTIONS] = { 1, -1, 0, 0 };
+
+static int on_board (int x, int y)
+{
+	return x >= 0 && x < BOARD_SIZE && y >= 0 && y < BOARD_SIZE;
+}
+
+static MoveResult die (GameState *state, MoveResult cause)
+{
+	state->pos_x = 0;
+	state->pos_y = 0;
+	state->score -= DEATH_PENALTY;
+	state->deaths++;
+	return cause;
+}
+
+static MoveResult land (GameState *state, int x, int y)
+{
+	state->pos_x = x;
+	state->pos_y = y;
+	if (x == GOAL_X && y == GOAL_Y)
+	{
+		state->score += WIN_BONUS;
+		state->won = 1;
+		return MOVE_WIN;
+	}
+	return MOVE_OK;
+}
+
+MoveResult game_move (GameState *state, const Layout *layout, Direction dir)
+{
+	int x = state->pos_x + dir_dx[dir];
+	int y = state->pos_y + dir_dy[dir];
+	if (!on_board(x, y))
+		return MOVE_NONE;
+
+	if (layout->obstacles[x] == y)
+		return die(state, MOVE_DEATH_OBSTACLE);
+	if (layout->holes[x] == y)
+		return die(state, MOVE_DEATH_HOLE);
+	if (layout->moving[x] == y)
+		return die(state, MOVE_DEATH_MOVING);
+	return land(state, x, y);
+}
+
+MoveResult game_jump (GameState *state, const Layout *layout, Direction dir)
+{
+	int x = state->pos_x + 2*dir_dx[dir];
+	int y = state->pos_y + 2*dir_dy[dir];
+	if (!on_board(x, y))
+		return MOVE_NONE;
+
+	if (layout->obstacles[x] == y)
+		return die(state, MOVE_DEATH_OBSTACLE);
+	if (layout->holes[x] == y)
+		return die(state, MOVE_DEATH_HOLE);
+	return land(state, x, y);
+}
+
+int move_result_is_death (MoveResult result)
+{
+	return result == MOVE_DEATH_HOLE || result == MOVE_DEATH_OBSTACLE || result == MOVE_DEATH_MOVING;
+}
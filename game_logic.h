@@ -0,0 +1,71 @@
+#ifndef GAME_LOGIC_H
+#define GAME_LOGIC_H
+
+#include <stdint.h>
+
+/* Rules of the game, free of any GL/GLFW state so that the game, the
+   batch tools and the level evaluator all share one implementation */
+
+#define BOARD_SIZE 10   // board is BOARD_SIZE x BOARD_SIZE tiles
+#define LAYOUT_SLOTS 11 // one slot per column (+1 spare, as in the original arrays)
+#define GOAL_X 9
+#define GOAL_Y 9
+#define DEATH_PENALTY 10
+#define WIN_BONUS 100
+
+/* For column i, holes[i], obstacles[i] and moving[i] hold the row of the
+   hole, obstacle and moving floor tile in that column. Rows outside
+   0..BOARD_SIZE-1 mean the column has none. */
+struct Layout {
+	int holes[LAYOUT_SLOTS];     // pits
+	int obstacles[LAYOUT_SLOTS]; // reshuffled every few seconds
+	int moving[LAYOUT_SLOTS];    // tiles oscillating up and down
+};
+
+struct GameState {
+	int pos_x, pos_y;
+	int score;
+	int deaths;
+	int won;
+};
+
+enum Direction { DIR_UP, DIR_DOWN, DIR_LEFT, DIR_RIGHT, NUM_DIRECTIONS };
+
+enum MoveResult {
+	MOVE_NONE,           // off the board, nothing happens
+	MOVE_OK,
+	MOVE_DEATH_HOLE,
+	MOVE_DEATH_OBSTACLE,
+	MOVE_DEATH_MOVING,
+	MOVE_WIN,
+	NUM_MOVE_RESULTS
+};
+
+/* Small per-owner RNG (splitmix64) - no hidden global state, so every
+   thread can own one */
+struct Rng {
+	uint64_t s;
+};
+
+void rng_seed (Rng *rng, uint64_t seed);
+uint64_t rng_next (Rng *rng);
+int rng_range (Rng *rng, int n); // uniform in [0, n)
+
+/* Same distribution as the original r()/rand_obj(): rows 1..11 */
+void layout_generate (Layout *layout, Rng *rng);
+void layout_shuffle_obstacles (Layout *layout, Rng *rng);
+void layout_from_seed (Layout *layout, uint64_t seed);
+
+void game_reset (GameState *state);
+
+/* Step one tile; a hole, obstacle or moving tile on the target sends the
+   player back to the start with a penalty */
+MoveResult game_move (GameState *state, const Layout *layout, Direction dir);
+
+/* Jump two tiles; only holes and obstacles on the landing tile count, so
+   moving tiles can be jumped over */
+MoveResult game_jump (GameState *state, const Layout *layout, Direction dir);
+
+int move_result_is_death (MoveResult result);
+
+#endif
@@ -0,0 +1,250 @@
+#include <cstdio>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <dlfcn.h>
+#include <glad/glad.h>
+
+#include "gl_hooks.h"
+#include "log.h"
+#include "trace.h"
+
+using namespace std;
+
+/* Every GL function the game calls, except glGetError (the wrappers use
+   it). Add new ones here; a function not listed is simply not seen */
+#define GL_HOOKED_FUNCTIONS(X) \
+	X(glAttachShader) X(glBeginQuery) X(glBindBuffer) X(glBindBufferBase) X(glBindBufferRange) \
+	X(glBindFramebuffer) X(glBindRenderbuffer) X(glBindVertexArray) X(glBlitFramebuffer) \
+	X(glBufferData) X(glBufferStorage) X(glBufferSubData) X(glCheckFramebufferStatus) \
+	X(glClear) X(glClearColor) X(glClearDepth) X(glClientWaitSync) X(glCompileShader) \
+	X(glCreateProgram) X(glCreateShader) X(glDeleteBuffers) X(glDeleteFramebuffers) \
+	X(glDeleteProgram) X(glDeleteQueries) X(glDeleteRenderbuffers) X(glDeleteShader) \
+	X(glDeleteSync) X(glDeleteVertexArrays) X(glDepthFunc) X(glDetachShader) X(glDisable) \
+	X(glDrawArrays) X(glDrawArraysInstanced) X(glDrawElements) X(glDrawElementsBaseVertex) \
+	X(glDrawElementsInstancedBaseVertex) X(glEnable) X(glEnableVertexAttribArray) X(glEndQuery) \
+	X(glFenceSync) X(glFinish) X(glFlush) X(glFlushMappedBufferRange) X(glFramebufferRenderbuffer) \
+	X(glGenBuffers) X(glGenFramebuffers) X(glGenQueries) X(glGenRenderbuffers) X(glGenVertexArrays) \
+	X(glGetActiveAttrib) X(glGetActiveUniform) X(glGetActiveUniformBlockName) \
+	X(glGetActiveUniformBlockiv) X(glGetAttribLocation) X(glGetInteger64v) X(glGetIntegerv) \
+	X(glGetProgramBinary) X(glGetProgramInfoLog) X(glGetProgramiv) X(glGetQueryObjectiv) \
+	X(glGetQueryObjectui64v) X(glGetShaderInfoLog) X(glGetShaderiv) X(glGetString) \
+	X(glGetUniformBlockIndex) X(glGetUniformLocation) X(glLinkProgram) X(glMapBufferRange) \
+	X(glMaxShaderCompilerThreadsARB) X(glPolygonMode) X(glProgramBinary) X(glProgramParameteri) \
+	X(glQueryCounter) X(glReadPixels) X(glRenderbufferStorage) X(glScissor) X(glShaderSource) \
+	X(glUniformBlockBinding) X(glUniformMatrix4fv) X(glUnmapBuffer) X(glUseProgram) \
+	X(glVertexAttribDivisor) X(glVertexAttribPointer) X(glViewport) X(glWaitSync)
+
+enum GlHookId {
+#define X(name) HOOK_##name,
+	GL_HOOKED_FUNCTIONS(X)
+#undef X
+	NUM_GL_HOOKS
+};
+
+static const char *hook_names[NUM_GL_HOOKS] = {
+#define X(name) #name,
+	GL_HOOKED_FUNCTIONS(X)
+#undef X
+};
+
+struct GlHookStats {
+	long frame_calls;
+	long calls;
+	double time;      // seconds inside the function, whole run
+	long errors;
+};
+
+/* Calls made on other threads, i.e. the shader compile worker's shared
+   context (shader_loader.cpp). They aren't part of any frame, so they are
+   only totalled, separately */
+struct GlHookOtherStats {
+	std::atomic<long> calls;
+	std::atomic<int64_t> time;  // ns
+	std::atomic<long> errors;
+};
+
+static GlHookStats stats[NUM_GL_HOOKS];       // the installing (GL) thread only
+static GlHookOtherStats other[NUM_GL_HOOKS];
+static std::thread::id hook_thread;
+static GLenum (APIENTRYP real_glGetError) (void);
+static FILE *hook_out;
+static long hook_frame;
+static double frame_time;
+
+static const char *error_name (GLenum error)
+{
+	switch (error) {
+		case GL_INVALID_ENUM: return "GL_INVALID_ENUM";
+		case GL_INVALID_VALUE: return "GL_INVALID_VALUE";
+		case GL_INVALID_OPERATION: return "GL_INVALID_OPERATION";
+		case GL_INVALID_FRAMEBUFFER_OPERATION: return "GL_INVALID_FRAMEBUFFER_OPERATION";
+		case GL_OUT_OF_MEMORY: return "GL_OUT_OF_MEMORY";
+		default: return "unknown GL error";
+	}
+}
+
+/* Times one call from construction to destruction, then checks for errors */
+struct HookCall {
+	int id;
+	void *caller;
+	chrono::steady_clock::time_point start;
+
+	HookCall (int id, void *caller) : id(id), caller(caller), start(chrono::steady_clock::now()) {}
+	~HookCall ()
+	{
+		chrono::steady_clock::duration elapsed = chrono::steady_clock::now() - start;
+		bool gl_thread = this_thread::get_id() == hook_thread;
+		if (gl_thread) {
+			double time = chrono::duration<double>(elapsed).count();
+			stats[id].frame_calls++;
+			stats[id].calls++;
+			stats[id].time += time;
+			frame_time += time;
+		}
+		else {
+			other[id].calls.fetch_add(1, std::memory_order_relaxed);
+			other[id].time.fetch_add(chrono::duration_cast<chrono::nanoseconds>(elapsed).count(), std::memory_order_relaxed);
+		}
+
+		GLenum error;
+		while ((error = real_glGetError()) != GL_NO_ERROR) {
+			// Offset from the start of the binary, which is what addr2line
+			// wants for a position independent executable
+			Dl_info info;
+			size_t offset = (size_t) caller;
+			if (dladdr(caller, &info) && info.dli_fbase)
+				offset -= (size_t) info.dli_fbase;
+			if (gl_thread) {
+				stats[id].errors++;
+				LOG(LOG_ERROR, "%s: %s in frame %ld, called from +0x%zx", hook_names[id], error_name(error), hook_frame, offset);
+			}
+			else {
+				other[id].errors.fetch_add(1, std::memory_order_relaxed);
+				LOG(LOG_ERROR, "%s: %s on another thread, called from +0x%zx", hook_names[id], error_name(error), offset);
+			}
+		}
+	}
+};
+
+/* The wrapper for one function, from the type of its glad pointer */
+template <int id, class P> struct GlHook;
+
+template <int id, class R, class... A>
+struct GlHook<id, R (APIENTRY *)(A...)> {
+	static R (APIENTRY *real)(A...);
+
+	static R APIENTRY call (A... args)
+	{
+		HookCall hook(id, __builtin_return_address(0));
+		return real(args...);
+	}
+};
+
+template <int id, class R, class... A>
+R (APIENTRY *GlHook<id, R (APIENTRY *)(A...)>::real)(A...);
+
+bool gl_hooks_install (const char *path)
+{
+	hook_out = fopen(path, "w");
+	if (!hook_out) {
+		perror(path);
+		return false;
+	}
+	real_glGetError = glad_glGetError;
+	// Threads started after this one (the shader compile worker) see it
+	hook_thread = this_thread::get_id();
+	// Functions the driver lacks stay NULL
+#define X(name) \
+	if (glad_##name) { \
+		GlHook<HOOK_##name, decltype(glad_##name)>::real = glad_##name; \
+		glad_##name = GlHook<HOOK_##name, decltype(glad_##name)>::call; \
+	}
+	GL_HOOKED_FUNCTIONS(X)
+#undef X
+
+	fprintf(hook_out, "frame,calls,ms");
+	for (int i=0; i<NUM_GL_HOOKS; i++)
+		fprintf(hook_out, ",%s", hook_names[i]);
+	fprintf(hook_out, "\n");
+	hook_frame = 0;
+	frame_time = 0;
+	return true;
+}
+
+void gl_hooks_frame ()
+{
+	if (!hook_out)
+		return;
+	long calls = 0;
+	for (int i=0; i<NUM_GL_HOOKS; i++)
+		calls += stats[i].frame_calls;
+	fprintf(hook_out, "%ld,%ld,%.3f", hook_frame, calls, 1000 * frame_time);
+	for (int i=0; i<NUM_GL_HOOKS; i++) {
+		fprintf(hook_out, ",%ld", stats[i].frame_calls);
+		stats[i].frame_calls = 0;
+	}
+	fprintf(hook_out, "\n");
+	trace_counter("GL calls", calls);
+	hook_frame++;
+	frame_time = 0;
+}
+
+static bool more_time (int a, int b)
+{
+	return stats[a].time > stats[b].time;
+}
+
+void gl_hooks_report (FILE *fp)
+{
+	if (!hook_out || hook_frame == 0)
+		return;
+	int order[NUM_GL_HOOKS];
+	long calls = 0, errors = 0;
+	double time = 0;
+	for (int i=0; i<NUM_GL_HOOKS; i++) {
+		order[i] = i;
+		calls += stats[i].calls;
+		errors += stats[i].errors;
+		time += stats[i].time;
+	}
+	sort(order, order + NUM_GL_HOOKS, more_time);
+	fprintf(fp, "GL CALLS: %ld frames, %.1f calls and %.3f ms in GL per frame, %ld errors\n",
+			hook_frame, (double) calls / hook_frame, 1000 * time / hook_frame, errors);
+	for (int k=0; k<NUM_GL_HOOKS && k<10 && stats[order[k]].calls > 0; k++) {
+		const GlHookStats &s = stats[order[k]];
+		fprintf(fp, "  %-36s %10ld calls %9.3f ms %8.1f per frame\n", hook_names[order[k]],
+				s.calls, 1000 * s.time, (double) s.calls / hook_frame);
+	}
+
+	long other_calls = 0, other_errors = 0;
+	int64_t other_time = 0;
+	for (int i=0; i<NUM_GL_HOOKS; i++) {
+		other_calls += other[i].calls.load(std::memory_order_relaxed);
+		other_errors += other[i].errors.load(std::memory_order_relaxed);
+		other_time += other[i].time.load(std::memory_order_relaxed);
+	}
+	if (other_calls == 0)
+		return;
+	fprintf(fp, "GL CALLS on other threads: %ld calls, %.3f ms, %ld errors\n", other_calls, other_time * 1e-6, other_errors);
+	for (int i=0; i<NUM_GL_HOOKS; i++) {
+		long calls = other[i].calls.load(std::memory_order_relaxed);
+		if (calls > 0)
+			fprintf(fp, "  %-36s %10ld calls %9.3f ms\n", hook_names[i], calls,
+					other[i].time.load(std::memory_order_relaxed) * 1e-6);
+	}
+}
+
+void gl_hooks_uninstall ()
+{
+	if (!hook_out)
+		return;
+#define X(name) \
+	if (GlHook<HOOK_##name, decltype(glad_##name)>::real) \
+		glad_##name = GlHook<HOOK_##name, decltype(glad_##name)>::real;
+	GL_HOOKED_FUNCTIONS(X)
+#undef X
+	fclose(hook_out);
+	hook_out = NULL;
+}
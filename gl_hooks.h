@@ -0,0 +1,41 @@
+#ifndef GL_HOOKS_H
+#define GL_HOOKS_H
+
+#include <stdio.h>
+
+/* GL call interception, to see which entry points a frame uses and how
+ * often (did batching or state caching actually cut driver calls?).
+ *
+ * glad calls GL through function pointers: glDrawElements is a macro for
+ * the glad_glDrawElements pointer that gladLoadGLLoader fills in. After
+ * that, gl_hooks_install points every function in GL_HOOKED_FUNCTIONS
+ * (gl_hooks.cpp) at a wrapper that
+ *   - counts the call, for this frame and for the run, and times it;
+ *   - calls glGetError afterwards and logs any error with the function,
+ *     the frame and the caller's offset in the binary, for
+ *     addr2line -f -e sample3D OFFSET. An error left by an unhooked
+ *     function shows up at the next hooked call.
+ * gl_hooks_frame, once per frame, appends the frame's counts to a CSV file
+ * (one column per function) and starts the next frame.
+ *
+ * Without gl_hooks_install the pointers stay glad's and nothing is added
+ * to any call. With it, every call pays two clock reads and a glGetError,
+ * which can be a driver round trip: compare call counts, not frame times.
+ *
+ * Only calls on the thread that called gl_hooks_install go into the
+ * per-frame counts. Calls on other threads with a context of their own
+ * (the shader compile worker, shader_loader.h) are totalled separately,
+ * with atomic counters, and listed on their own by gl_hooks_report. The
+ * functions here are for the installing thread only.
+ */
+
+/* Hook the functions and write the per-frame CSV to path */
+bool gl_hooks_install (const char *path);
+/* Write this frame's line, then reset the per-frame counts */
+void gl_hooks_frame ();
+/* Totals for the run, the most expensive functions first */
+void gl_hooks_report (FILE *fp);
+/* Put glad's pointers back and close the CSV */
+void gl_hooks_uninstall ();
+
+#endif
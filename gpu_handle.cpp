@@ -0,0 +1,70 @@
+#include "gpu_handle.h"
+
+GpuStats gpu_stats;
+
+static const char *kind_names[NUM_GPU_OBJECT_KINDS] = { "buffers", "vertex arrays", "programs", "framebuffers",
+	"renderbuffers", "queries" };
+
+GLuint gpu_object_create (GpuObjectKind kind)
+{
+	GLuint id = 0;
+	switch (kind) {
+	case GPU_BUFFER:       glGenBuffers(1, &id); break;
+	case GPU_VERTEX_ARRAY: glGenVertexArrays(1, &id); break;
+	case GPU_PROGRAM:      id = glCreateProgram(); break;
+	case GPU_FRAMEBUFFER:  glGenFramebuffers(1, &id); break;
+	case GPU_RENDERBUFFER: glGenRenderbuffers(1, &id); break;
+	case GPU_QUERY:        glGenQueries(1, &id); break;
+	default: break;
+	}
+	if (id)
+		gpu_object_adopt(kind);
+	return id;
+}
+
+void gpu_object_adopt (GpuObjectKind kind)
+{
+	gpu_stats.live[kind]++;
+	gpu_stats.created[kind]++;
+}
+
+void gpu_object_delete (GpuObjectKind kind, GLuint id, size_t bytes)
+{
+	switch (kind) {
+	case GPU_BUFFER:       glDeleteBuffers(1, &id); break;
+	case GPU_VERTEX_ARRAY: glDeleteVertexArrays(1, &id); break;
+	case GPU_PROGRAM:      glDeleteProgram(id); break;
+	case GPU_FRAMEBUFFER:  glDeleteFramebuffers(1, &id); break;
+	case GPU_RENDERBUFFER: glDeleteRenderbuffers(1, &id); break;
+	case GPU_QUERY:        glDeleteQueries(1, &id); break;
+	default: break;
+	}
+	gpu_stats.live[kind]--;
+	gpu_stats.buffer_bytes -= bytes;
+}
+
+void gpu_buffer_data (GpuBuffer &buffer, GLenum target, size_t bytes, const void *data, GLenum usage)
+{
+	glBindBuffer(target, buffer.get());
+	glBufferData(target, bytes, data, usage);
+	buffer.set_bytes(bytes);
+}
+
+void gpu_renderbuffer_storage (GpuRenderbuffer &renderbuffer, GLenum format, int width, int height, int bytes_per_pixel)
+{
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer.get());
+	glRenderbufferStorage(GL_RENDERBUFFER, format, width, height);
+	renderbuffer.set_bytes((size_t) width * height * bytes_per_pixel);
+}
+
+long gpu_report (FILE *fp)
+{
+	long live = 0;
+	fprintf(fp, "GPU:");
+	for (int i=0; i<NUM_GPU_OBJECT_KINDS; i++) {
+		fprintf(fp, "%s %ld/%ld %s live", i ? "," : "", gpu_stats.live[i], gpu_stats.created[i], kind_names[i]);
+		live += gpu_stats.live[i];
+	}
+	fprintf(fp, ", %zu buffer bytes live (peak %zu)\n", gpu_stats.buffer_bytes, gpu_stats.peak_buffer_bytes);
+	return live;
+}
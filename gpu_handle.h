@@ -0,0 +1,112 @@
+#ifndef GPU_HANDLE_H
+#define GPU_HANDLE_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <glad/glad.h>
+
+/* Move-only owners for GL objects, deleted when the owner goes away.
+ *
+ * Every live object is counted, and buffers also count the bytes given to
+ * gpu_buffer_data, so gpu_report can list what is still alive at
+ * shutdown. Handles must be released while the context is current: free
+ * meshes and programs before glfwTerminate, not in static destructors.
+ * GL objects are only created and deleted on the main context's thread.
+ */
+
+enum GpuObjectKind {
+	GPU_BUFFER,
+	GPU_VERTEX_ARRAY,
+	GPU_PROGRAM,
+	GPU_FRAMEBUFFER,
+	GPU_RENDERBUFFER,
+	GPU_QUERY,
+	NUM_GPU_OBJECT_KINDS
+};
+
+struct GpuStats {
+	long live[NUM_GPU_OBJECT_KINDS];
+	long created[NUM_GPU_OBJECT_KINDS];
+	size_t buffer_bytes;      // currently allocated, buffers and renderbuffers
+	size_t peak_buffer_bytes;
+};
+
+extern GpuStats gpu_stats;
+
+GLuint gpu_object_create (GpuObjectKind kind);
+void gpu_object_adopt (GpuObjectKind kind);
+void gpu_object_delete (GpuObjectKind kind, GLuint id, size_t bytes);
+
+template <GpuObjectKind Kind>
+class GpuHandle {
+public:
+	GpuHandle () : id_(0), bytes_(0) {}
+	/* Take ownership of an object created elsewhere (e.g. by the loader) */
+	explicit GpuHandle (GLuint id) : id_(id), bytes_(0) { if (id) gpu_object_adopt(Kind); }
+	~GpuHandle () { reset(); }
+
+	GpuHandle (const GpuHandle &) = delete;
+	GpuHandle &operator= (const GpuHandle &) = delete;
+	GpuHandle (GpuHandle &&other) : id_(other.id_), bytes_(other.bytes_) { other.id_ = 0; other.bytes_ = 0; }
+	GpuHandle &operator= (GpuHandle &&other)
+	{
+		if (this != &other) {
+			reset();
+			id_ = other.id_;
+			bytes_ = other.bytes_;
+			other.id_ = 0;
+			other.bytes_ = 0;
+		}
+		return *this;
+	}
+
+	static GpuHandle create () { GpuHandle h; h.id_ = gpu_object_create(Kind); return h; }
+
+	GLuint get () const { return id_; }
+	explicit operator bool () const { return id_ != 0; }
+
+	void reset ()
+	{
+		if (id_)
+			gpu_object_delete(Kind, id_, bytes_);
+		id_ = 0;
+		bytes_ = 0;
+	}
+
+	/* Storage size, for the accounting; set by gpu_buffer_data and
+	   gpu_renderbuffer_storage */
+	size_t bytes () const { return bytes_; }
+	void set_bytes (size_t bytes);
+
+private:
+	GLuint id_;
+	size_t bytes_;
+};
+
+template <GpuObjectKind Kind>
+void GpuHandle<Kind>::set_bytes (size_t bytes)
+{
+	gpu_stats.buffer_bytes += bytes - bytes_;
+	if (gpu_stats.buffer_bytes > gpu_stats.peak_buffer_bytes)
+		gpu_stats.peak_buffer_bytes = gpu_stats.buffer_bytes;
+	bytes_ = bytes;
+}
+
+typedef GpuHandle<GPU_BUFFER> GpuBuffer;
+typedef GpuHandle<GPU_VERTEX_ARRAY> GpuVertexArray;
+typedef GpuHandle<GPU_PROGRAM> GpuProgram;
+typedef GpuHandle<GPU_FRAMEBUFFER> GpuFramebuffer;
+typedef GpuHandle<GPU_RENDERBUFFER> GpuRenderbuffer;
+typedef GpuHandle<GPU_QUERY> GpuQuery;
+
+/* glBufferData on target, which buffer gets bound to */
+void gpu_buffer_data (GpuBuffer &buffer, GLenum target, size_t bytes, const void *data, GLenum usage);
+
+/* glRenderbufferStorage, single sample; bytes_per_pixel for the accounting */
+void gpu_renderbuffer_storage (GpuRenderbuffer &renderbuffer, GLenum format, int width, int height, int bytes_per_pixel);
+
+/* Live objects and buffer bytes; anything still alive is a leak if this is
+   called after everything was released. Returns the number of live objects. */
+long gpu_report (FILE *fp);
+
+#endif
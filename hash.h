@@ -0,0 +1,25 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* 64-bit FNV-1a, usable at compile time for string literals */
+
+#define HASH_BASIS 14695981039346656037ULL
+#define HASH_PRIME 1099511628211ULL
+
+constexpr uint64_t hash_str (const char *s, uint64_t h = HASH_BASIS)
+{
+	return *s ? hash_str(s + 1, (h ^ (uint64_t)(unsigned char)*s) * HASH_PRIME) : h;
+}
+
+inline uint64_t hash_bytes (const void *data, size_t len, uint64_t h = HASH_BASIS)
+{
+	const unsigned char *p = (const unsigned char*) data;
+	for (size_t i=0; i<len; i++)
+		h = (h ^ p[i]) * HASH_PRIME;
+	return h;
+}
+
+#endif
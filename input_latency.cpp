@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <GLFW/glfw3.h>
+
+#include "input_latency.h"
+#include "log.h"
+
+using namespace std;
+
+#define LATENCY_CALIBRATE 1.0   // seconds between GPU clock calibrations
+
+/* Line up the GPU's timestamp clock with glfwGetTime(). GL_TIMESTAMP is read
+   without waiting for the GPU, so the two are sampled back to back */
+static void calibrate (LatencyTracker *tracker)
+{
+	GLint64 gpu = 0;
+	double before = glfwGetTime();
+	glGetInteger64v(GL_TIMESTAMP, &gpu);
+	double after = glfwGetTime();
+	tracker->gpu_offset = (before + after) / 2 - gpu * 1e-9;
+	tracker->calibrated = after;
+}
+
+static void record (vector<float> &samples, double seconds)
+{
+	if (samples.size() < LATENCY_MAX_SAMPLES)
+		samples.push_back((float) (1000 * seconds));
+}
+
+void latency_init (LatencyTracker *tracker)
+{
+	tracker->lost = 0;
+	tracker->holding = false;
+	for (int i=0; i<LATENCY_FRAMES; i++) {
+		tracker->frames[i].query = GpuQuery::create();
+		tracker->frames[i].pending = false;
+		tracker->frames[i].count = 0;
+	}
+	tracker->frame = 0;
+	tracker->recent_swap = 0;
+	calibrate(tracker);
+}
+
+void latency_destroy (LatencyTracker *tracker)
+{
+	for (int i=0; i<LATENCY_FRAMES; i++)
+		tracker->frames[i].query.reset();
+}
+
+void latency_applied (LatencyTracker *tracker, long seq, double event_time, double tick_time)
+{
+	record(tracker->tick, tick_time - event_time);
+	InputStamp stamp = { seq, event_time };
+	if (!tracker->applied.push(stamp))
+		tracker->lost++;
+}
+
+/* Record the GPU completion of frames whose timestamp has come back, oldest
+   first, without waiting for any */
+static void read_queries (LatencyTracker *tracker)
+{
+	for (int k=0; k<LATENCY_FRAMES; k++) {
+		LatencyFrame &frame = tracker->frames[(tracker->frame + k) % LATENCY_FRAMES];
+		if (!frame.pending)
+			continue;
+		GLint available = 0;
+		glGetQueryObjectiv(frame.query.get(), GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			break;
+		GLuint64 ns = 0;
+		glGetQueryObjectui64v(frame.query.get(), GL_QUERY_RESULT, &ns);
+		double done = ns * 1e-9 + tracker->gpu_offset;
+		for (int i=0; i<frame.count; i++)
+			record(tracker->gpu, done - frame.times[i]);
+		frame.pending = false;
+	}
+}
+
+void latency_frame (LatencyTracker *tracker, long input_seq)
+{
+	LatencyFrame &frame = tracker->frames[tracker->frame];
+	if (frame.pending) {
+		// Its timestamp is LATENCY_FRAMES frames old and still not back
+		LOG(LOG_DEBUG, "GPU timestamp for %d input events not ready, dropped", frame.count);
+		frame.pending = false;
+	}
+	frame.count = 0;
+
+	// Every event the drawn state includes, and no later one
+	InputStamp stamp;
+	for (;;) {
+		if (tracker->holding)
+			stamp = tracker->held;
+		else if (!tracker->applied.pop(stamp))
+			break;
+		tracker->holding = stamp.seq > input_seq;
+		if (tracker->holding) {
+			tracker->held = stamp;
+			break;
+		}
+		if (frame.count < LATENCY_FRAME_EVENTS)
+			frame.times[frame.count++] = stamp.time;
+	}
+
+	// Frames without new input cost no query
+	if (frame.count > 0)
+		glQueryCounter(frame.query.get(), GL_TIMESTAMP);
+}
+
+void latency_presented (LatencyTracker *tracker, double swap_time)
+{
+	LatencyFrame &frame = tracker->frames[tracker->frame];
+	for (int i=0; i<frame.count; i++) {
+		double latency = swap_time - frame.times[i];
+		record(tracker->swap, latency);
+		tracker->recent_swap = tracker->recent_swap > 0 ? tracker->recent_swap + 0.1 * (latency - tracker->recent_swap) : latency;
+	}
+	frame.pending = frame.count > 0;
+	tracker->frame = (tracker->frame + 1) % LATENCY_FRAMES;
+
+	read_queries(tracker);
+	if (swap_time - tracker->calibrated > LATENCY_CALIBRATE)
+		calibrate(tracker);
+}
+
+static void report_stage (const char *name, vector<float> &samples, FILE *fp)
+{
+	if (samples.empty())
+		return;
+	sort(samples.begin(), samples.end());
+	size_t n = samples.size();
+	fprintf(fp, ", %s p50 %.2f ms, p99 %.2f ms, max %.2f ms", name,
+			samples[n / 2], samples[(n * 99) / 100], samples[n - 1]);
+}
+
+void latency_report (LatencyTracker *tracker, FILE *fp)
+{
+	if (tracker->tick.empty())
+		return;
+	fprintf(fp, "LATENCY: %zu events", tracker->tick.size());
+	report_stage("to tick", tracker->tick, fp);
+	report_stage("to swap", tracker->swap, fp);
+	report_stage("to GPU done", tracker->gpu, fp);
+	if (tracker->lost > 0)
+		fprintf(fp, ", %ld not tracked", tracker->lost);
+	fprintf(fp, "\n");
+}
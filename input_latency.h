@@ -0,0 +1,74 @@
+#ifndef INPUT_LATENCY_H
+#define INPUT_LATENCY_H
+
+#include <stdio.h>
+#include <vector>
+#include <glad/glad.h>
+
+#include "gpu_handle.h"
+#include "spsc_queue.h"
+
+/* Input-to-photon latency, per input event, in three stages:
+ *
+ *   tick    callback to the simulation tick that applied the event
+ *   swap    callback to the return of glfwSwapBuffers for the first frame
+ *           drawn from a state that includes the event
+ *   gpu     callback to the GPU finishing that frame (GL_TIMESTAMP query
+ *           after the draws, mapped to glfwGetTime's clock)
+ *
+ * Events are numbered as the simulation applies them, and the world state
+ * carries the number of the last one, so the renderer knows which events
+ * a snapshot reflects even when it skips snapshots.
+ *
+ *   simulation thread:  latency_applied(&t, seq, event.time, now);
+ *   GL thread:          draw(state); latency_frame(&t, state.input_seq);
+ *                       glfwSwapBuffers(); latency_presented(&t, glfwGetTime());
+ */
+
+#define LATENCY_FRAMES 4          // frames whose GPU timestamp may be in flight
+#define LATENCY_FRAME_EVENTS 32   // events timed per frame; more are only counted
+#define LATENCY_MAX_SAMPLES 100000
+
+struct InputStamp {
+	long seq;
+	double time;                  // glfwGetTime() in the input callback
+};
+
+struct LatencyFrame {
+	GpuQuery query;
+	bool pending;
+	int count;
+	double times[LATENCY_FRAME_EVENTS];
+};
+
+struct LatencyTracker {
+	SpscQueue<InputStamp, 1024> applied; // simulation -> renderer
+	long lost;                    // stamps that didn't fit in applied (simulation thread)
+
+	InputStamp held;              // popped, but newer than the frame being drawn
+	bool holding;
+	LatencyFrame frames[LATENCY_FRAMES];
+	int frame;                    // the one being drawn
+	double gpu_offset;            // glfwGetTime() - GPU timestamp, seconds
+	double calibrated;            // when gpu_offset was measured
+
+	std::vector<float> tick, swap, gpu; // milliseconds
+	double recent_swap;           // callback to swap, seconds, smoothed over recent events
+};
+
+/* GL thread, context current */
+void latency_init (LatencyTracker *tracker);
+void latency_destroy (LatencyTracker *tracker);
+
+/* Simulation thread: event seq, stamped at event_time, was applied at tick_time */
+void latency_applied (LatencyTracker *tracker, long seq, double event_time, double tick_time);
+
+/* GL thread, after the draws of a frame showing state up to event input_seq */
+void latency_frame (LatencyTracker *tracker, long input_seq);
+/* GL thread, right after glfwSwapBuffers */
+void latency_presented (LatencyTracker *tracker, double swap_time);
+
+/* After the simulation thread has stopped */
+void latency_report (LatencyTracker *tracker, FILE *fp);
+
+#endif
@@ -0,0 +1,307 @@
+/* Monte Carlo level-difficulty evaluator
+ *
+ * Plays many agent episodes on a layout (or on every layout of a seed
+ * range) through game_logic and reports win rate, mean steps and what
+ * killed the player. Episodes are split across threads; each thread owns
+ * its RNG and counters and only publishes them after it is done, so the
+ * hot loop shares nothing.
+ *
+ *   ./level_eval --seeds 1-100 --episodes 1000000 --agent heuristic
+ *   ./level_eval --layout level.txt --threads 8
+ *
+ * A layout file holds three lines of BOARD_SIZE rows: holes, obstacles
+ * and moving tiles (column 0 first). Lines starting with # are ignored.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "game_logic.h"
+
+using namespace std;
+
+enum Agent { AGENT_RANDOM, AGENT_HEURISTIC };
+
+struct EvalConfig {
+	long long episodes;
+	int threads;
+	Agent agent;
+	int max_steps;
+	int lives;          // 0 = play until win or max_steps
+	int reshuffle;      // agent steps between obstacle reshuffles, 0 = never
+	uint64_t seed;
+};
+
+struct EvalStats {
+	long long episodes;
+	long long wins;
+	long long steps;
+	long long win_steps;
+	long long deaths[3]; // hole, obstacle, moving
+};
+
+/* One slot per thread, padded so that writers never share a cache line */
+struct alignas(64) ThreadSlot {
+	EvalStats stats;
+};
+
+static void stats_add (EvalStats *to, const EvalStats *from)
+{
+	to->episodes += from->episodes;
+	to->wins += from->wins;
+	to->steps += from->steps;
+	to->win_steps += from->win_steps;
+	for (int i=0; i<3; i++)
+		to->deaths[i] += from->deaths[i];
+}
+
+static int tile_blocked (const Layout *l, int x, int y, int jump)
+{
+	if (x < 0 || x >= BOARD_SIZE || y < 0 || y >= BOARD_SIZE)
+		return 1;
+	return l->obstacles[x] == y || l->holes[x] == y || (!jump && l->moving[x] == y);
+}
+
+/* Action ids: 0..3 move in Direction, 4..7 jump in Direction */
+static int pick_action (Agent agent, const GameState *s, const Layout *l, Rng *rng)
+{
+	static const int dx[NUM_DIRECTIONS] = { 0, 0, -1, 1 };
+	static const int dy[NUM_DIRECTIONS] = { 1, -1, 0, 0 };
+
+	if (agent == AGENT_RANDOM || rng_range(rng, 10) == 0)
+		return rng_range(rng, 2*NUM_DIRECTIONS);
+
+	// Greedy: the safe action that gets closest to the goal, ties broken randomly
+	int best = -1, best_dist = 1 << 30, ties = 0;
+	for (int action=0; action<2*NUM_DIRECTIONS; action++)
+	{
+		int dir = action % NUM_DIRECTIONS, len = action < NUM_DIRECTIONS ? 1 : 2;
+		int x = s->pos_x + len*dx[dir], y = s->pos_y + len*dy[dir];
+		if (tile_blocked(l, x, y, len == 2))
+			continue;
+		int dist = (GOAL_X - x) + (GOAL_Y - y);
+		if (dist < best_dist)
+		{
+			best = action;
+			best_dist = dist;
+			ties = 1;
+		}
+		else if (dist == best_dist && rng_range(rng, ++ties) == 0)
+			best = action;
+	}
+	return best >= 0 ? best : rng_range(rng, 2*NUM_DIRECTIONS);
+}
+
+static void run_episodes (const Layout *start, const EvalConfig *cfg, long long count, uint64_t seed, EvalStats *out)
+{
+	EvalStats st;
+	memset(&st, 0, sizeof(st));
+	Rng rng;
+	rng_seed(&rng, seed);
+
+	for (long long ep=0; ep<count; ep++)
+	{
+		Layout layout = *start;
+		GameState s;
+		game_reset(&s);
+		int step;
+		for (step=0; step<cfg->max_steps && !s.won; step++)
+		{
+			if (cfg->reshuffle > 0 && step > 0 && step % cfg->reshuffle == 0)
+				layout_shuffle_obstacles(&layout, &rng);
+
+			int action = pick_action(cfg->agent, &s, &layout, &rng);
+			Direction dir = (Direction)(action % NUM_DIRECTIONS);
+			MoveResult res = action < NUM_DIRECTIONS ? game_move(&s, &layout, dir) : game_jump(&s, &layout, dir);
+			if (res == MOVE_DEATH_HOLE)
+				st.deaths[0]++;
+			else if (res == MOVE_DEATH_OBSTACLE)
+				st.deaths[1]++;
+			else if (res == MOVE_DEATH_MOVING)
+				st.deaths[2]++;
+			if (cfg->lives > 0 && s.deaths >= cfg->lives)
+			{
+				step++;
+				break;
+			}
+		}
+		st.episodes++;
+		st.steps += step;
+		if (s.won)
+		{
+			st.wins++;
+			st.win_steps += step;
+		}
+	}
+	*out = st;
+}
+
+static EvalStats evaluate (const Layout *layout, const EvalConfig *cfg, uint64_t layout_seed)
+{
+	vector<ThreadSlot> slots(cfg->threads);
+	vector<thread> workers;
+	for (int t=0; t<cfg->threads; t++)
+	{
+		long long begin = cfg->episodes * t / cfg->threads;
+		long long end = cfg->episodes * (t+1) / cfg->threads;
+		// Decorrelate thread streams through splitmix of (run seed, layout, thread)
+		Rng mix;
+		rng_seed(&mix, cfg->seed ^ (layout_seed * 0x100000001B3ULL) ^ ((uint64_t)t << 48));
+		uint64_t seed = rng_next(&mix);
+		workers.push_back(thread(run_episodes, layout, cfg, end - begin, seed, &slots[t].stats));
+	}
+	EvalStats total;
+	memset(&total, 0, sizeof(total));
+	for (int t=0; t<cfg->threads; t++)
+	{
+		workers[t].join();
+		stats_add(&total, &slots[t].stats);
+	}
+	return total;
+}
+
+static void report (const char *name, const EvalStats *st)
+{
+	double n = st->episodes > 0 ? (double)st->episodes : 1;
+	printf("%-16s win %6.2f%%  mean steps %7.2f  steps to win %7.2f  deaths/episode: hole %.3f obstacle %.3f moving %.3f\n",
+			name, 100.0*st->wins/n, st->steps/n,
+			st->wins > 0 ? (double)st->win_steps/st->wins : 0.0,
+			st->deaths[0]/n, st->deaths[1]/n, st->deaths[2]/n);
+}
+
+static int load_layout (const char *path, Layout *layout)
+{
+	ifstream in(path);
+	if (!in.is_open())
+		return 0;
+	int *rows[3] = { layout->holes, layout->obstacles, layout->moving };
+	int row = 0;
+	string line;
+	for (int i=0; i<LAYOUT_SLOTS; i++)
+		layout->holes[i] = layout->obstacles[i] = layout->moving[i] = -1;
+	while (row < 3 && getline(in, line))
+	{
+		if (line.empty() || line[0] == '#')
+			continue;
+		istringstream ss(line);
+		for (int i=0; i<BOARD_SIZE; i++)
+			if (!(ss >> rows[row][i]))
+				return 0;
+		row++;
+	}
+	return row == 3;
+}
+
+static void usage (const char *prog)
+{
+	fprintf(stderr, "usage: %s (--layout FILE | --seeds FIRST-LAST) [--episodes N] [--threads N]\n"
+			"          [--agent random|heuristic] [--max-steps N] [--lives N] [--reshuffle N] [--seed N]\n", prog);
+	exit(EXIT_FAILURE);
+}
+
+int main (int argc, char** argv)
+{
+	EvalConfig cfg;
+	cfg.episodes = 1000000;
+	cfg.threads = (int) thread::hardware_concurrency();
+	cfg.agent = AGENT_HEURISTIC;
+	cfg.max_steps = 500;
+	cfg.lives = 3;
+	cfg.reshuffle = 12; // ~6 s at two moves per second, like the game's reshuffle
+	cfg.seed = 1;
+	if (cfg.threads < 1)
+		cfg.threads = 1;
+
+	const char *layout_path = NULL;
+	unsigned long long first = 0, last = 0;
+	int have_seeds = 0;
+
+	for (int i=1; i<argc; i++)
+	{
+		const char *arg = argv[i];
+		if (i+1 >= argc)
+			usage(argv[0]);
+		const char *val = argv[++i];
+		if (!strcmp(arg, "--layout"))
+			layout_path = val;
+		else if (!strcmp(arg, "--seeds"))
+		{
+			if (sscanf(val, "%llu-%llu", &first, &last) != 2)
+			{
+				if (sscanf(val, "%llu", &first) != 1)
+					usage(argv[0]);
+				last = first;
+			}
+			have_seeds = 1;
+		}
+		else if (!strcmp(arg, "--episodes"))
+			cfg.episodes = atoll(val);
+		else if (!strcmp(arg, "--threads"))
+			cfg.threads = atoi(val);
+		else if (!strcmp(arg, "--agent"))
+		{
+			if (!strcmp(val, "random"))
+				cfg.agent = AGENT_RANDOM;
+			else if (!strcmp(val, "heuristic"))
+				cfg.agent = AGENT_HEURISTIC;
+			else
+				usage(argv[0]);
+		}
+		else if (!strcmp(arg, "--max-steps"))
+			cfg.max_steps = atoi(val);
+		else if (!strcmp(arg, "--lives"))
+			cfg.lives = atoi(val);
+		else if (!strcmp(arg, "--reshuffle"))
+			cfg.reshuffle = atoi(val);
+		else if (!strcmp(arg, "--seed"))
+			cfg.seed = strtoull(val, NULL, 10);
+		else
+			usage(argv[0]);
+	}
+	if ((layout_path == NULL) == (have_seeds == 0) || cfg.threads < 1 || cfg.episodes < 1 || last < first)
+		usage(argv[0]);
+
+	printf("%lld episodes per layout, %d threads, %s agent\n", cfg.episodes, cfg.threads,
+			cfg.agent == AGENT_RANDOM ? "random" : "heuristic");
+
+	auto start = chrono::steady_clock::now();
+	EvalStats total;
+	memset(&total, 0, sizeof(total));
+	if (layout_path)
+	{
+		Layout layout;
+		if (!load_layout(layout_path, &layout))
+		{
+			fprintf(stderr, "Error: cannot read layout %s\n", layout_path);
+			return EXIT_FAILURE;
+		}
+		total = evaluate(&layout, &cfg, 0);
+		report(layout_path, &total);
+	}
+	else
+	{
+		for (unsigned long long seed=first; seed<=last; seed++)
+		{
+			Layout layout;
+			layout_from_seed(&layout, seed);
+			EvalStats st = evaluate(&layout, &cfg, seed);
+			char name[32];
+			snprintf(name, sizeof(name), "seed %llu", seed);
+			report(name, &st);
+			stats_add(&total, &st);
+		}
+		if (last > first)
+			report("all", &total);
+	}
+	double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	printf("%lld episodes, %lld steps in %.2f s (%.0f episodes/s)\n", total.episodes, total.steps, secs, total.episodes/secs);
+	return EXIT_SUCCESS;
+}
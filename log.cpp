@@ -0,0 +1,243 @@
+#include <cctype>
+#include <cstdarg>
+#include <cstdlib>
+#include <strings.h>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+
+#include "log.h"
+#include "spsc_queue.h"
+
+using namespace std;
+
+#define LOG_RING 1024          // records per thread
+#define LOG_MAX_THREADS 16
+#define LOG_WRITER_SLEEP_MS 5  // writer's poll interval when there is nothing to write
+
+typedef SpscQueue<LogRecord, LOG_RING> LogRing;
+
+static_assert(sizeof(LogRecord) == 128, "LogRecord should stay two cache lines");
+
+std::atomic<int> log_level(LOG_INFO);
+
+// Rings are claimed by threads on their first record and never given back;
+// the writer only reads the first num_rings of them
+static LogRing rings[LOG_MAX_THREADS];
+static std::atomic<int> num_rings(0);
+static thread_local LogRing *my_ring;
+static thread_local bool no_ring;
+static std::atomic<long> dropped(0);
+
+static std::atomic<bool> running(false);
+static std::thread writer;
+static FILE *log_out;
+static std::mutex sync_mutex;  // direct writes while the writer isn't running
+static const chrono::steady_clock::time_point log_start = chrono::steady_clock::now();
+
+static const char *level_names[NUM_LOG_LEVELS] = { "DEBUG", "INFO", "WARN", "ERROR" };
+
+bool log_begin (LogSite *site, int level, const char *format, LogRecord *record)
+{
+	int64_t now = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - log_start).count();
+	int64_t second = now / 1000000000;
+	if (site->second.load(std::memory_order_relaxed) != second) {
+		site->second.store(second, std::memory_order_relaxed);
+		site->count.store(0, std::memory_order_relaxed);
+	}
+	if (site->count.fetch_add(1, std::memory_order_relaxed) >= LOG_SITE_RATE) {
+		site->suppressed.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	record->time = now;
+	record->format = format;
+	record->suppressed = site->suppressed.exchange(0, std::memory_order_relaxed);
+	record->level = level;
+	record->nargs = 0;
+	record->text_used = 0;
+	return true;
+}
+
+/* Append to buf at *used, never past size */
+static void append (char *buf, size_t size, size_t *used, const char *format, ...)
+	__attribute__((format(printf, 4, 5)));
+static void append (char *buf, size_t size, size_t *used, const char *format, ...)
+{
+	if (*used >= size)
+		return;
+	va_list args;
+	va_start(args, format);
+	int n = vsnprintf(buf + *used, size - *used, format, args);
+	va_end(args);
+	if (n > 0)
+		*used = min(size - 1, *used + n);
+}
+
+/* Format one conversion (spec is "%" flags width precision, conv the
+   letter) with argument n of the record, whatever type it was logged as */
+static void format_arg (char *buf, size_t size, size_t *used, const LogRecord &record, int n,
+		const string &spec, char conv)
+{
+	if (n >= record.nargs) {
+		append(buf, size, used, "<?>");
+		return;
+	}
+	const LogArg &arg = record.arg[n];
+	int type = record.type[n];
+	bool floating = strchr("fFeEgGaA", conv) != NULL;
+	char format[32];
+	if (type == LOG_ARG_STRING || conv == 's') {
+		snprintf(format, sizeof(format), "%ss", spec.c_str());
+		if (type == LOG_ARG_STRING)
+			append(buf, size, used, format, record.text + arg.text);
+		else if (type == LOG_ARG_DOUBLE)
+			append(buf, size, used, "%g", arg.d);
+		else if (type == LOG_ARG_POINTER)
+			append(buf, size, used, "%p", arg.p);
+		else
+			append(buf, size, used, type == LOG_ARG_INT ? "%lld" : "%llu", type == LOG_ARG_INT ? (long long) arg.i : (unsigned long long) arg.u);
+	}
+	else if (type == LOG_ARG_POINTER || conv == 'p') {
+		append(buf, size, used, "%p", arg.p);
+	}
+	else if (floating) {
+		snprintf(format, sizeof(format), "%s%c", spec.c_str(), conv);
+		double d = type == LOG_ARG_DOUBLE ? arg.d : type == LOG_ARG_INT ? (double) arg.i : (double) arg.u;
+		append(buf, size, used, format, d);
+	}
+	else if (conv == 'c') {
+		snprintf(format, sizeof(format), "%sc", spec.c_str());
+		append(buf, size, used, format, (int) arg.i);
+	}
+	else {
+		// d i u x X o, as long long
+		snprintf(format, sizeof(format), "%sll%c", spec.c_str(), conv);
+		long long v = type == LOG_ARG_DOUBLE ? (long long) arg.d : arg.i;
+		append(buf, size, used, format, v);
+	}
+}
+
+/* The record's line, with a newline, in buf */
+static size_t format_record (const LogRecord &record, char *buf, size_t size)
+{
+	size_t used = 0;
+	append(buf, size, &used, "[%9.3f] %-5s ", record.time * 1e-9, level_names[record.level]);
+	int n = 0;
+	for (const char *p = record.format; *p; p++) {
+		if (*p != '%') {
+			if (used < size - 1)
+				buf[used++] = *p;
+			continue;
+		}
+		if (p[1] == '%') {
+			if (used < size - 1)
+				buf[used++] = '%';
+			p++;
+			continue;
+		}
+		// %[flags][width][.precision][length]conversion; lengths are dropped,
+		// each argument already knows its size
+		string spec = "%";
+		p++;
+		while (*p && strchr("-+ #0", *p))
+			spec += *p++;
+		while (*p && (isdigit((unsigned char) *p) || *p == '.'))
+			spec += *p++;
+		while (*p && strchr("hlLqjzt", *p))
+			p++;
+		if (!*p)
+			break;
+		format_arg(buf, size, &used, record, n++, spec, *p);
+	}
+	if (record.suppressed)
+		append(buf, size, &used, " (%u more suppressed)", record.suppressed);
+	buf[used] = '\0';
+	if (used < size - 1)
+		buf[used++] = '\n';
+	buf[used] = '\0';
+	return used;
+}
+
+static bool earlier (const LogRecord &a, const LogRecord &b)
+{
+	return a.time < b.time;
+}
+
+/* Drain every ring and write what was in them, oldest first */
+static bool write_pending (vector<LogRecord> *batch)
+{
+	batch->clear();
+	int n = min(num_rings.load(std::memory_order_acquire), LOG_MAX_THREADS);
+	LogRecord record;
+	for (int i=0; i<n; i++)
+		while (rings[i].pop(record))
+			batch->push_back(record);
+	if (batch->empty())
+		return false;
+	stable_sort(batch->begin(), batch->end(), earlier);
+	char line[512];
+	for (size_t i=0; i<batch->size(); i++)
+		fwrite(line, 1, format_record((*batch)[i], line, sizeof(line)), log_out);
+	fflush(log_out);
+	return true;
+}
+
+static void writer_loop ()
+{
+	vector<LogRecord> batch;
+	batch.reserve(LOG_RING);
+	while (running.load(std::memory_order_acquire))
+		if (!write_pending(&batch))
+			this_thread::sleep_for(chrono::milliseconds(LOG_WRITER_SLEEP_MS));
+	write_pending(&batch);
+}
+
+void log_commit (LogRecord *record)
+{
+	if (!running.load(std::memory_order_acquire)) {
+		char line[512];
+		lock_guard<mutex> lock(sync_mutex);
+		FILE *out = log_out ? log_out : stderr;
+		fwrite(line, 1, format_record(*record, line, sizeof(line)), out);
+		return;
+	}
+	if (!my_ring && !no_ring) {
+		int index = num_rings.fetch_add(1, std::memory_order_acq_rel);
+		if (index < LOG_MAX_THREADS)
+			my_ring = &rings[index];
+		else
+			no_ring = true;
+	}
+	if (!my_ring || !my_ring->push(*record))
+		dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void log_init (FILE *out)
+{
+	const char *level = getenv("SAMPLE3D_LOG");
+	if (level)
+		for (int i=0; i<NUM_LOG_LEVELS; i++)
+			if (!strcasecmp(level, level_names[i]))
+				log_level = i;
+	log_out = out;
+	running = true;
+	writer = std::thread(writer_loop);
+}
+
+void log_shutdown ()
+{
+	if (!running)
+		return;
+	running = false;
+	writer.join();
+	// Anything pushed after the writer's last look
+	vector<LogRecord> batch;
+	write_pending(&batch);
+}
+
+long log_dropped ()
+{
+	return dropped.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,151 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <stdint.h>
+#include <type_traits>
+
+/* Asynchronous logging for code that runs every frame or every tick.
+ *
+ *   LOG(LOG_INFO, "Reloading shaders %s, %s", vertex_name, fragment_name);
+ *
+ * The calling thread only fills a fixed-size LogRecord (format address,
+ * timestamp, raw argument values) and pushes it into its own SpscQueue; no
+ * formatting, locking or I/O. A writer thread started by log_init drains
+ * every thread's ring, formats the records in time order and writes them.
+ *
+ * The format must be a string literal: only its address is kept. String
+ * arguments are copied into the record, LOG_TEXT bytes for all of them
+ * together, and truncated beyond that. Each LOG() call site passes at most
+ * LOG_SITE_RATE records per second; the rest are counted and reported with
+ * the next record that gets through. Records below log_level (LOG_INFO, or
+ * $SAMPLE3D_LOG=debug|info|warn|error) cost one relaxed load and a branch.
+ * A full ring drops the record and counts it.
+ *
+ * Before log_init and after log_shutdown, LOG() formats and writes on the
+ * calling thread, so messages during start-up and shutdown still appear.
+ */
+
+enum LogLevel { LOG_DEBUG, LOG_INFO, LOG_WARN, LOG_ERROR, NUM_LOG_LEVELS };
+
+#define LOG_MAX_ARGS 6
+#define LOG_TEXT 48
+#define LOG_SITE_RATE 20
+
+enum LogArgType { LOG_ARG_INT, LOG_ARG_UINT, LOG_ARG_DOUBLE, LOG_ARG_STRING, LOG_ARG_POINTER };
+
+union LogArg {
+	int64_t i;
+	uint64_t u;
+	double d;
+	const void *p;
+	uint32_t text;   // LOG_ARG_STRING: offset in LogRecord::text
+};
+
+/* 128 bytes: two cache lines per record */
+struct LogRecord {
+	int64_t time;           // ns since the log started
+	const char *format;
+	uint32_t suppressed;    // dropped by this site's rate limit since its last record
+	uint8_t level, nargs, text_used;
+	uint8_t type[LOG_MAX_ARGS];
+	LogArg arg[LOG_MAX_ARGS];
+	char text[LOG_TEXT];
+};
+
+/* Rate limit state of one LOG() call site */
+struct LogSite {
+	std::atomic<int64_t> second;
+	std::atomic<int> count;
+	std::atomic<uint32_t> suppressed;
+};
+
+extern std::atomic<int> log_level;
+
+/* Start the writer thread; records go to out every few milliseconds */
+void log_init (FILE *out);
+/* Write everything queued and stop the writer thread */
+void log_shutdown ();
+/* Records dropped because a thread's ring was full */
+long log_dropped ();
+
+bool log_begin (LogSite *site, int level, const char *format, LogRecord *record);
+void log_commit (LogRecord *record);
+
+inline void log_put (LogRecord *record, LogArgType type, LogArg value)
+{
+	if (record->nargs < LOG_MAX_ARGS) {
+		record->type[record->nargs] = type;
+		record->arg[record->nargs++] = value;
+	}
+}
+
+inline void log_put (LogRecord *record, const char *s)
+{
+	LogArg value;
+	value.text = record->text_used;
+	size_t room = LOG_TEXT - record->text_used;
+	size_t len = s ? strnlen(s, room - 1) : 0;
+	if (len)
+		memcpy(record->text + record->text_used, s, len);
+	record->text[record->text_used + len] = '\0';
+	// Once full, later strings share the last byte and come out empty
+	record->text_used = record->text_used + len + 1 < LOG_TEXT ? record->text_used + len + 1 : LOG_TEXT - 1;
+	log_put(record, LOG_ARG_STRING, value);
+}
+
+inline void log_put (LogRecord *record, const std::string &s)
+{
+	log_put(record, s.c_str());
+}
+
+inline void log_put (LogRecord *record, double d)
+{
+	LogArg value;
+	value.d = d;
+	log_put(record, LOG_ARG_DOUBLE, value);
+}
+
+inline void log_put (LogRecord *record, const void *p)
+{
+	LogArg value;
+	value.p = p;
+	log_put(record, LOG_ARG_POINTER, value);
+}
+
+template <class T>
+typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+log_put (LogRecord *record, T v)
+{
+	LogArg value;
+	if (std::is_signed<T>::value || std::is_enum<T>::value) {
+		value.i = (int64_t) v;
+		log_put(record, LOG_ARG_INT, value);
+	}
+	else {
+		value.u = (uint64_t) v;
+		log_put(record, LOG_ARG_UINT, value);
+	}
+}
+
+template <class... Args>
+void log_write (LogSite *site, int level, const char *format, const Args &... args)
+{
+	LogRecord record;
+	if (!log_begin(site, level, format, &record))
+		return;
+	int expand[] = { 0, (log_put(&record, args), 0)... };
+	(void) expand;
+	log_commit(&record);
+}
+
+#define LOG(level, ...) do { \
+	static LogSite log_site_; \
+	if ((level) >= log_level.load(std::memory_order_relaxed)) \
+		log_write(&log_site_, (level), __VA_ARGS__); \
+} while (0)
+
+#endif
@@ -0,0 +1,139 @@
+#include <cstdio>
+#include <cstddef>
+
+#include "mesh_buffer.h"
+
+using namespace std;
+
+static void range_init (RangeAllocator *space, uint32_t capacity)
+{
+	space->free.clear();
+	FreeRange all = { 0, capacity };
+	space->free.push_back(all);
+}
+
+/* First fit; false if no free range is big enough */
+static bool range_alloc (RangeAllocator *space, uint32_t size, uint32_t *offset)
+{
+	for (size_t i=0; i<space->free.size(); i++) {
+		FreeRange &r = space->free[i];
+		if (r.size < size)
+			continue;
+		*offset = r.offset;
+		r.offset += size;
+		r.size -= size;
+		if (r.size == 0)
+			space->free.erase(space->free.begin() + i);
+		return true;
+	}
+	return false;
+}
+
+static void range_free (RangeAllocator *space, uint32_t offset, uint32_t size)
+{
+	vector<FreeRange> &free = space->free;
+	size_t i = 0;
+	while (i < free.size() && free[i].offset < offset)
+		i++;
+	FreeRange r = { offset, size };
+	free.insert(free.begin() + i, r);
+	// Merge with the next range, then with the previous one
+	if (i + 1 < free.size() && free[i].offset + free[i].size == free[i+1].offset) {
+		free[i].size += free[i+1].size;
+		free.erase(free.begin() + i + 1);
+	}
+	if (i > 0 && free[i-1].offset + free[i-1].size == free[i].offset) {
+		free[i-1].size += free[i].size;
+		free.erase(free.begin() + i);
+	}
+}
+
+void mesh_buffer_create (MeshBuffer *buffer, uint32_t vertex_capacity, uint32_t index_capacity)
+{
+	buffer->vertex_capacity = vertex_capacity;
+	buffer->index_capacity = index_capacity;
+	buffer->meshes = 0;
+	range_init(&buffer->vertex_space, vertex_capacity);
+	range_init(&buffer->index_space, index_capacity);
+
+	buffer->vao = GpuVertexArray::create();
+	buffer->vertices = GpuBuffer::create();
+	buffer->indices = GpuBuffer::create();
+
+	glBindVertexArray(buffer->vao.get());
+	gpu_buffer_data(buffer->vertices, GL_ARRAY_BUFFER, vertex_capacity * sizeof(MeshVertex), NULL, GL_STATIC_DRAW);
+	// The element binding is part of the VAO
+	gpu_buffer_data(buffer->indices, GL_ELEMENT_ARRAY_BUFFER, index_capacity * sizeof(GLuint), NULL, GL_STATIC_DRAW);
+
+	glEnableVertexAttribArray(ATTRIB_POSITION);
+	glVertexAttribPointer(ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex),
+			(void*) offsetof(MeshVertex, position));
+	glEnableVertexAttribArray(ATTRIB_COLOR);
+	glVertexAttribPointer(ATTRIB_COLOR, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex),
+			(void*) offsetof(MeshVertex, color));
+	glBindVertexArray(0);
+}
+
+void mesh_buffer_destroy (MeshBuffer *buffer)
+{
+	if (buffer->meshes > 0)
+		fprintf(stderr, "Warning: mesh buffer destroyed with %d meshes in it\n", buffer->meshes);
+	buffer->vao.reset();
+	buffer->vertices.reset();
+	buffer->indices.reset();
+}
+
+bool mesh_alloc (MeshBuffer *buffer, const MeshVertex *vertices, int vertex_count,
+		const GLuint *indices, int index_count, MeshRange *mesh)
+{
+	if (!indices)
+		index_count = vertex_count;
+	if (vertex_count <= 0 || index_count <= 0)
+		return false;
+	uint32_t base_vertex, first_index;
+	if (!range_alloc(&buffer->vertex_space, vertex_count, &base_vertex))
+		return false;
+	if (!range_alloc(&buffer->index_space, index_count, &first_index)) {
+		range_free(&buffer->vertex_space, base_vertex, vertex_count);
+		return false;
+	}
+
+	vector<GLuint> in_order;
+	if (!indices) {
+		in_order.resize(index_count);
+		for (int i=0; i<index_count; i++)
+			in_order[i] = i;
+		indices = &in_order[0];
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffer->vertices.get());
+	glBufferSubData(GL_ARRAY_BUFFER, base_vertex * sizeof(MeshVertex), vertex_count * sizeof(MeshVertex), vertices);
+	// Don't disturb whatever VAO is bound; GL_COPY_WRITE_BUFFER has no VAO state
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer->indices.get());
+	glBufferSubData(GL_COPY_WRITE_BUFFER, first_index * sizeof(GLuint), index_count * sizeof(GLuint), indices);
+
+	mesh->base_vertex = base_vertex;
+	mesh->first_index = first_index;
+	mesh->index_count = index_count;
+	mesh->vertex_count = vertex_count;
+	buffer->meshes++;
+	return true;
+}
+
+void mesh_free (MeshBuffer *buffer, MeshRange *mesh)
+{
+	if (mesh->vertex_count == 0)
+		return;
+	range_free(&buffer->vertex_space, mesh->base_vertex, mesh->vertex_count);
+	range_free(&buffer->index_space, mesh->first_index, mesh->index_count);
+	mesh->index_count = mesh->vertex_count = 0;
+	buffer->meshes--;
+}
+
+void mesh_buffer_instances (GLuint instances, GLintptr offset)
+{
+	glBindBuffer(GL_ARRAY_BUFFER, instances);
+	glEnableVertexAttribArray(ATTRIB_INSTANCE_OFFSET);
+	glVertexAttribPointer(ATTRIB_INSTANCE_OFFSET, 3, GL_FLOAT, GL_FALSE, 3*sizeof(GLfloat), (void*) offset);
+	glVertexAttribDivisor(ATTRIB_INSTANCE_OFFSET, 1);
+}
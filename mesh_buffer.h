@@ -0,0 +1,87 @@
+#ifndef MESH_BUFFER_H
+#define MESH_BUFFER_H
+
+#include <stdint.h>
+#include <vector>
+#include <glad/glad.h>
+
+#include "gpu_handle.h"
+
+/* All static meshes of one vertex format in a single vertex buffer and a
+ * single index buffer, behind one VAO.
+ *
+ * A mesh is a range of each, drawn with glDrawElementsBaseVertex, so
+ * switching meshes needs no rebinds: bind the buffer once per frame and
+ * draw any number of meshes from it. Space is handed out first-fit from
+ * sorted free lists and coalesced on free, so meshes generated at runtime
+ * (per level, per chunk) can come and go.
+ */
+
+/* Vertex attribute locations, shared with the shaders */
+enum VertexSlot {
+	ATTRIB_POSITION,
+	ATTRIB_COLOR,
+	ATTRIB_INSTANCE_OFFSET, // per instance, FEATURE_INSTANCED only
+};
+
+struct MeshVertex {
+	GLfloat position[3];
+	GLfloat color[3];
+};
+
+struct MeshRange {
+	GLint base_vertex;   // added to every index
+	GLuint first_index;
+	GLsizei index_count;
+	GLsizei vertex_count;
+};
+
+struct FreeRange {
+	uint32_t offset, size;
+};
+
+/* Free space in some unit (vertices or indices), sorted by offset */
+struct RangeAllocator {
+	std::vector<FreeRange> free;
+};
+
+struct MeshBuffer {
+	GpuVertexArray vao;
+	GpuBuffer vertices, indices;
+	RangeAllocator vertex_space, index_space;
+	uint32_t vertex_capacity, index_capacity;
+	int meshes; // live
+};
+
+void mesh_buffer_create (MeshBuffer *buffer, uint32_t vertex_capacity, uint32_t index_capacity);
+void mesh_buffer_destroy (MeshBuffer *buffer);
+
+/* Copy a mesh in. With indices NULL, the vertices are drawn in order
+   (index_count is ignored). False if there's no room left. */
+bool mesh_alloc (MeshBuffer *buffer, const MeshVertex *vertices, int vertex_count,
+		const GLuint *indices, int index_count, MeshRange *mesh);
+void mesh_free (MeshBuffer *buffer, MeshRange *mesh);
+
+inline void mesh_buffer_bind (const MeshBuffer *buffer)
+{
+	glBindVertexArray(buffer->vao.get());
+}
+
+/* The buffer holding mesh must be bound */
+inline void mesh_draw (const MeshRange *mesh, GLenum mode)
+{
+	glDrawElementsBaseVertex(mode, mesh->index_count, GL_UNSIGNED_INT,
+			(void*) (mesh->first_index * sizeof(GLuint)), mesh->base_vertex);
+}
+
+/* Point ATTRIB_INSTANCE_OFFSET (one vec3 per instance) at offset in
+   instances; this is VAO state, so the mesh buffer must be bound */
+void mesh_buffer_instances (GLuint instances, GLintptr offset);
+
+inline void mesh_draw_instanced (const MeshRange *mesh, GLenum mode, GLsizei count)
+{
+	glDrawElementsInstancedBaseVertex(mode, mesh->index_count, GL_UNSIGNED_INT,
+			(void*) (mesh->first_index * sizeof(GLuint)), count, mesh->base_vertex);
+}
+
+#endif
@@ -0,0 +1,273 @@
+#include <cmath>
+#include <cerrno>
+#include <cstdarg>
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "metrics.h"
+#include "log.h"
+
+using namespace std;
+
+#define METRICS_POLL_MS 200     // how often the server checks for shutdown
+#define METRICS_REQUEST_MS 100  // how long it waits for a request line
+#define METRICS_RETRIES 100
+
+const double metrics_bucket_bounds[METRICS_BUCKETS] = {
+	0.004, 0.008, 0.012, 0.0167, 0.020, 0.025, 0.0334, 0.050, 0.100, INFINITY
+};
+
+static_assert(sizeof(MetricsValues) % 8 == 0, "MetricsValues should have no tail padding");
+
+bool metrics_snapshot (const MetricsBlock *block, MetricsValues *values)
+{
+	for (int i=0; i<METRICS_RETRIES; i++) {
+		uint32_t before = block->seq.load(std::memory_order_acquire);
+		if (before & 1)
+			continue;
+		memcpy(values, &block->values, sizeof(MetricsValues));
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (block->seq.load(std::memory_order_relaxed) == before)
+			return true;
+	}
+	return false;
+}
+
+/* Append to buf at *used, never past size */
+static void append (char *buf, size_t size, size_t *used, const char *format, ...)
+	__attribute__((format(printf, 4, 5)));
+static void append (char *buf, size_t size, size_t *used, const char *format, ...)
+{
+	if (*used >= size)
+		return;
+	va_list args;
+	va_start(args, format);
+	int n = vsnprintf(buf + *used, size - *used, format, args);
+	va_end(args);
+	if (n > 0)
+		*used = min(size - 1, *used + n);
+}
+
+static void metric (char *buf, size_t size, size_t *used, const char *name, const char *type, const char *help, double value)
+{
+	append(buf, size, used, "# HELP sample3d_%s %s\n# TYPE sample3d_%s %s\nsample3d_%s %.17g\n",
+			name, help, name, type, name, value);
+}
+
+size_t metrics_format (const MetricsValues &v, char *buf, size_t size)
+{
+	size_t used = 0;
+	buf[0] = '\0';
+	metric(buf, size, &used, "frames_total", "counter", "Frames presented.", (double) v.frames);
+	metric(buf, size, &used, "fps", "gauge", "Frames per second over the last second.", v.fps);
+
+	append(buf, size, &used, "# HELP sample3d_frame_time_seconds Time between presents.\n"
+			"# TYPE sample3d_frame_time_seconds histogram\n");
+	uint64_t cumulative = 0;
+	for (int i=0; i<METRICS_BUCKETS; i++) {
+		cumulative += v.frame_time_buckets[i];
+		if (isinf(metrics_bucket_bounds[i]))
+			append(buf, size, &used, "sample3d_frame_time_seconds_bucket{le=\"+Inf\"} %llu\n", (unsigned long long) cumulative);
+		else
+			append(buf, size, &used, "sample3d_frame_time_seconds_bucket{le=\"%g\"} %llu\n",
+					metrics_bucket_bounds[i], (unsigned long long) cumulative);
+	}
+	append(buf, size, &used, "sample3d_frame_time_seconds_sum %.17g\nsample3d_frame_time_seconds_count %llu\n",
+			v.frame_time_sum, (unsigned long long) cumulative);
+
+	metric(buf, size, &used, "draw_calls", "gauge", "Draw calls in the last frame.", (double) v.draw_calls);
+	metric(buf, size, &used, "gpu_buffer_bytes", "gauge", "Bytes in GPU buffers and renderbuffers.", (double) v.gpu_buffer_bytes);
+	metric(buf, size, &used, "sim_ticks_total", "counter", "Simulation ticks.", (double) v.ticks);
+	metric(buf, size, &used, "sim_tick_rate_hertz", "gauge", "Simulation ticks per second over the last second.", v.tick_rate);
+	metric(buf, size, &used, "input_events_total", "counter", "Input events applied.", (double) v.input_events);
+	metric(buf, size, &used, "input_latency_seconds", "gauge", "Input callback to swap, recent events.", v.input_latency);
+	metric(buf, size, &used, "score", "gauge", "Current score.", v.score);
+	metric(buf, size, &used, "deaths", "gauge", "Deaths so far.", v.deaths);
+	return used;
+}
+
+/* Write all of len bytes, or give up on error */
+static void send_all (int fd, const char *data, size_t len)
+{
+	while (len > 0) {
+		ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+		if (n <= 0)
+			return;
+		data += n;
+		len -= n;
+	}
+}
+
+/* Answer one connection: Prometheus text, as an HTTP response if asked
+   with GET, else bare (for nc -U and the like) */
+static void serve_client (const MetricsBlock *block, int fd)
+{
+	char request[512];
+	ssize_t got = 0;
+	pollfd wait = { fd, POLLIN, 0 };
+	if (poll(&wait, 1, METRICS_REQUEST_MS) > 0)
+		got = recv(fd, request, sizeof(request) - 1, 0);
+	bool http = got >= 4 && !memcmp(request, "GET ", 4);
+
+	char body[4096];
+	size_t len = 0;
+	MetricsValues values;
+	if (metrics_snapshot(block, &values))
+		len = metrics_format(values, body, sizeof(body));
+	if (http) {
+		char header[160];
+		int n = snprintf(header, sizeof(header), "HTTP/1.0 %s\r\nContent-Type: text/plain; version=0.0.4\r\n"
+				"Content-Length: %zu\r\n\r\n", len ? "200 OK" : "503 Service Unavailable", len);
+		send_all(fd, header, n);
+	}
+	send_all(fd, body, len);
+}
+
+static void server_loop (Metrics *metrics)
+{
+	while (metrics->serving.load(std::memory_order_acquire)) {
+		pollfd wait = { metrics->listen_fd, POLLIN, 0 };
+		if (poll(&wait, 1, METRICS_POLL_MS) <= 0)
+			continue;
+		int fd = accept(metrics->listen_fd, NULL, NULL);
+		if (fd < 0)
+			continue;
+		serve_client(metrics->block, fd);
+		close(fd);
+	}
+}
+
+static bool open_socket (Metrics *metrics, const char *path)
+{
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(address.sun_path)) {
+		LOG(LOG_ERROR, "metrics socket path %s is too long", path);
+		return false;
+	}
+	strcpy(address.sun_path, path);
+	metrics->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (metrics->listen_fd < 0) {
+		LOG(LOG_ERROR, "metrics socket: %s", strerror(errno));
+		return false;
+	}
+	// A socket left over from an instance that didn't exit cleanly
+	unlink(path);
+	if (bind(metrics->listen_fd, (sockaddr*) &address, sizeof(address)) < 0 || listen(metrics->listen_fd, 4) < 0) {
+		LOG(LOG_ERROR, "metrics socket %s: %s", path, strerror(errno));
+		close(metrics->listen_fd);
+		metrics->listen_fd = -1;
+		return false;
+	}
+	strcpy(metrics->socket_path, path);
+	metrics->serving = true;
+	metrics->server = std::thread(server_loop, metrics);
+	return true;
+}
+
+bool metrics_open (Metrics *metrics, const char *socket_path)
+{
+	metrics->block = NULL;
+	metrics->listen_fd = -1;
+	metrics->socket_path[0] = '\0';
+	metrics->serving = false;
+	metrics->window_start = -1;
+	metrics->window_frames = 0;
+	metrics->window_ticks = 0;
+
+	snprintf(metrics->shm_name, sizeof(metrics->shm_name), "/sample3d.%d", (int) getpid());
+	int fd = shm_open(metrics->shm_name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+	if (fd < 0) {
+		LOG(LOG_ERROR, "metrics shared memory %s: %s", metrics->shm_name, strerror(errno));
+		return false;
+	}
+	void *memory = MAP_FAILED;
+	if (ftruncate(fd, sizeof(MetricsBlock)) == 0)
+		memory = mmap(NULL, sizeof(MetricsBlock), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (memory == MAP_FAILED) {
+		LOG(LOG_ERROR, "metrics shared memory %s: %s", metrics->shm_name, strerror(errno));
+		shm_unlink(metrics->shm_name);
+		return false;
+	}
+	// ftruncate zeroed it: seq is 0 and the values are empty
+	metrics->block = (MetricsBlock*) memory;
+	metrics->block->pid = getpid();
+	metrics->block->version = METRICS_VERSION;
+	metrics->block->magic = METRICS_MAGIC;
+
+	if (socket_path && !open_socket(metrics, socket_path)) {
+		metrics_close(metrics);
+		return false;
+	}
+	return true;
+}
+
+void metrics_publish (Metrics *metrics, const MetricsFrame &frame)
+{
+	MetricsBlock *block = metrics->block;
+	if (!block)
+		return;
+	MetricsValues &v = block->values;
+
+	uint32_t seq = block->seq.load(std::memory_order_relaxed);
+	block->seq.store(seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	v.updated = frame.time;
+	v.frames++;
+	v.frame_time_sum += frame.frame_time;
+	int bucket = 0;
+	while (bucket < METRICS_BUCKETS - 1 && frame.frame_time > metrics_bucket_bounds[bucket])
+		bucket++;
+	v.frame_time_buckets[bucket]++;
+	v.draw_calls = frame.draw_calls;
+	v.gpu_buffer_bytes = frame.gpu_buffer_bytes;
+	v.ticks = frame.ticks;
+	v.input_events = frame.input_events;
+	v.input_latency = frame.input_latency;
+	v.score = frame.score;
+	v.deaths = frame.deaths;
+
+	// Rates over whole windows, so a single slow frame doesn't swing them
+	if (metrics->window_start < 0) {
+		metrics->window_start = frame.time;
+		metrics->window_frames = v.frames;
+		metrics->window_ticks = frame.ticks;
+	}
+	else if (frame.time - metrics->window_start >= METRICS_RATE_WINDOW) {
+		double elapsed = frame.time - metrics->window_start;
+		v.fps = (v.frames - metrics->window_frames) / elapsed;
+		v.tick_rate = (frame.ticks - metrics->window_ticks) / elapsed;
+		metrics->window_start = frame.time;
+		metrics->window_frames = v.frames;
+		metrics->window_ticks = frame.ticks;
+	}
+
+	block->seq.store(seq + 2, std::memory_order_release);
+}
+
+void metrics_close (Metrics *metrics)
+{
+	if (metrics->serving) {
+		metrics->serving = false;
+		metrics->server.join();
+	}
+	if (metrics->listen_fd >= 0) {
+		close(metrics->listen_fd);
+		metrics->listen_fd = -1;
+		unlink(metrics->socket_path);
+	}
+	if (metrics->block) {
+		munmap(metrics->block, sizeof(MetricsBlock));
+		metrics->block = NULL;
+		shm_unlink(metrics->shm_name);
+	}
+}
@@ -0,0 +1,98 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+
+/* Live health metrics for processes running side by side on one host,
+ * readable without attaching a debugger.
+ *
+ * The GL thread publishes a fixed-layout MetricsBlock once per frame into
+ * the POSIX shared memory object /sample3d.<pid>. The block is guarded by
+ * a seqlock: the writer makes seq odd, writes the values and makes it even
+ * again; a reader copies the values and retries if seq was odd or changed
+ * meanwhile (metrics_snapshot). Publishing is a few stores, no locks and no
+ * system calls.
+ *
+ * With a socket path, a background thread also answers connections on a
+ * Unix socket with the values in Prometheus text format (with an HTTP
+ * header if the request is a GET), e.g.
+ *
+ *   curl --unix-socket /tmp/sample3d.sock http://localhost/metrics
+ *   ./metrics_dump PID                  # same text, from shared memory
+ */
+
+#define METRICS_MAGIC 0x4d334453    // "SD3M"
+#define METRICS_VERSION 1
+#define METRICS_BUCKETS 10
+#define METRICS_RATE_WINDOW 1.0     // seconds over which fps and tick rate are measured
+
+/* Frame time histogram bucket upper bounds, seconds; the last is +Inf */
+extern const double metrics_bucket_bounds[METRICS_BUCKETS];
+
+struct MetricsValues {
+	double updated;                 // glfwGetTime() of the last publish
+	uint64_t frames;
+	double fps;
+	double frame_time_sum;          // seconds
+	uint64_t frame_time_buckets[METRICS_BUCKETS]; // frames per bucket, not cumulative
+	uint64_t draw_calls;            // last frame
+	uint64_t gpu_buffer_bytes;
+	uint64_t ticks;
+	double tick_rate;               // simulation ticks per second
+	uint64_t input_events;
+	double input_latency;           // callback to swap, seconds, recent events
+	int32_t score;
+	int32_t deaths;
+};
+
+struct MetricsBlock {
+	uint32_t magic;
+	uint32_t version;
+	int32_t pid;
+	std::atomic<uint32_t> seq;      // odd while the values are being written
+	MetricsValues values;
+};
+
+/* One frame's worth of input to metrics_publish */
+struct MetricsFrame {
+	double time;                    // glfwGetTime() after the swap
+	double frame_time;              // seconds since the previous swap
+	long draw_calls;
+	size_t gpu_buffer_bytes;
+	long ticks;
+	long input_events;
+	double input_latency;
+	int score, deaths;
+};
+
+struct Metrics {
+	MetricsBlock *block;
+	char shm_name[64];
+	int listen_fd;
+	char socket_path[108];
+	std::thread server;
+	std::atomic<bool> serving;
+
+	double window_start;
+	uint64_t window_frames;
+	long window_ticks;
+};
+
+/* Create the shared memory block and, if socket_path isn't NULL, start
+   serving it there. False (and nothing published) on failure */
+bool metrics_open (Metrics *metrics, const char *socket_path);
+/* GL thread, once per frame */
+void metrics_publish (Metrics *metrics, const MetricsFrame &frame);
+/* Stop serving and remove the shared memory object and the socket */
+void metrics_close (Metrics *metrics);
+
+/* Reader side: a consistent copy of the values, false if the writer kept
+   changing them */
+bool metrics_snapshot (const MetricsBlock *block, MetricsValues *values);
+/* Prometheus text exposition of values; returns its length */
+size_t metrics_format (const MetricsValues &values, char *buf, size_t size);
+
+#endif
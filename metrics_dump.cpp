@@ -0,0 +1,66 @@
+/* Print a running sample3D's metrics from its shared memory block
+ *
+ *   ./metrics_dump PID             # once, Prometheus text
+ *   ./metrics_dump PID --watch 1   # every second until it exits
+ *
+ * Reads /sample3d.PID (see metrics.h) without any help from the process.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "metrics.h"
+
+using namespace std;
+
+int main (int argc, char** argv)
+{
+	if (argc != 2 && !(argc == 4 && !strcmp(argv[2], "--watch"))) {
+		fprintf(stderr, "usage: %s PID [--watch SECONDS]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	double watch = argc == 4 ? atof(argv[3]) : 0;
+
+	char name[64];
+	pid_t pid = atoi(argv[1]);
+	snprintf(name, sizeof(name), "/sample3d.%d", (int) pid);
+	int fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0) {
+		perror(name);
+		return EXIT_FAILURE;
+	}
+	void *memory = mmap(NULL, sizeof(MetricsBlock), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (memory == MAP_FAILED) {
+		perror(name);
+		return EXIT_FAILURE;
+	}
+	const MetricsBlock *block = (const MetricsBlock*) memory;
+	if (block->magic != METRICS_MAGIC || block->version != METRICS_VERSION) {
+		fprintf(stderr, "%s: not a version %d metrics block\n", name, METRICS_VERSION);
+		return EXIT_FAILURE;
+	}
+
+	char text[4096];
+	for (;;) {
+		MetricsValues values;
+		if (!metrics_snapshot(block, &values)) {
+			fprintf(stderr, "%s: values kept changing, try again\n", name);
+			return EXIT_FAILURE;
+		}
+		fwrite(text, 1, metrics_format(values, text, sizeof(text)), stdout);
+		fflush(stdout);
+		if (watch <= 0)
+			break;
+		usleep((useconds_t) (watch * 1e6));
+		if (kill(pid, 0) != 0)
+			break;
+		printf("\n");
+	}
+	return EXIT_SUCCESS;
+}
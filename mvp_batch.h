@@ -0,0 +1,91 @@
+#ifndef MVP_BATCH_H
+#define MVP_BATCH_H
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* MVP matrices for many objects at once, specialised on how much of a
+ * model matrix can be non-trivial.
+ *
+ * A general VP * M is 64 multiplies. With M a translation, VP * T(t) is
+ * VP with its last column replaced by VP * (t, 1): 12 multiplies, and the
+ * other three columns are plain copies. A uniform scale s multiplies those
+ * three columns by s. Only TRANSFORM_AFFINE does the full product (48
+ * multiplies, the bottom row of M being 0 0 0 1).
+ *
+ * All matrices are column-major float[16], as glm stores them.
+ */
+
+enum TransformKind {
+	TRANSFORM_TRANSLATE,       // translation: 3 floats per object
+	TRANSFORM_TRANSLATE_SCALE, // translation + scale: 3 + 1 floats
+	TRANSFORM_AFFINE,          // affine: 12 floats, the top 3 rows of M, column-major
+};
+
+struct ModelBatch {
+	const float *translation; // TRANSLATE, TRANSLATE_SCALE
+	const float *scale;       // TRANSLATE_SCALE
+	const float *affine;      // AFFINE
+};
+
+/* mvp[16*i..] = vp * model i, for count models */
+template <TransformKind Kind>
+void mvp_batch (const float *vp, const ModelBatch &models, int count, float *mvp)
+{
+#ifdef __SSE2__
+	const __m128 c0 = _mm_loadu_ps(vp), c1 = _mm_loadu_ps(vp + 4);
+	const __m128 c2 = _mm_loadu_ps(vp + 8), c3 = _mm_loadu_ps(vp + 12);
+	for (int i=0; i<count; i++, mvp += 16) {
+		if (Kind == TRANSFORM_AFFINE) {
+			const float *m = models.affine + 12*i;
+			for (int j=0; j<4; j++) {
+				__m128 col = _mm_add_ps(_mm_add_ps(
+						_mm_mul_ps(c0, _mm_set1_ps(m[3*j])), _mm_mul_ps(c1, _mm_set1_ps(m[3*j + 1]))),
+						_mm_mul_ps(c2, _mm_set1_ps(m[3*j + 2])));
+				if (j == 3)
+					col = _mm_add_ps(col, c3);
+				_mm_storeu_ps(mvp + 4*j, col);
+			}
+			continue;
+		}
+		const float *t = models.translation + 3*i;
+		__m128 offset = _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(c0, _mm_set1_ps(t[0])), _mm_mul_ps(c1, _mm_set1_ps(t[1]))),
+				_mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(t[2])), c3));
+		if (Kind == TRANSFORM_TRANSLATE_SCALE) {
+			__m128 s = _mm_set1_ps(models.scale[i]);
+			_mm_storeu_ps(mvp, _mm_mul_ps(c0, s));
+			_mm_storeu_ps(mvp + 4, _mm_mul_ps(c1, s));
+			_mm_storeu_ps(mvp + 8, _mm_mul_ps(c2, s));
+		}
+		else {
+			_mm_storeu_ps(mvp, c0);
+			_mm_storeu_ps(mvp + 4, c1);
+			_mm_storeu_ps(mvp + 8, c2);
+		}
+		_mm_storeu_ps(mvp + 12, offset);
+	}
+#else
+	for (int i=0; i<count; i++, mvp += 16) {
+		float m[12];
+		if (Kind == TRANSFORM_AFFINE) {
+			for (int k=0; k<12; k++)
+				m[k] = models.affine[12*i + k];
+		}
+		else {
+			float s = Kind == TRANSFORM_TRANSLATE_SCALE ? models.scale[i] : 1.0f;
+			for (int k=0; k<9; k++)
+				m[k] = k % 4 == 0 ? s : 0; // diagonal of the 3x3 part
+			for (int k=0; k<3; k++)
+				m[9 + k] = models.translation[3*i + k];
+		}
+		for (int j=0; j<4; j++)
+			for (int r=0; r<4; r++)
+				mvp[4*j + r] = vp[r] * m[3*j] + vp[4 + r] * m[3*j + 1] + vp[8 + r] * m[3*j + 2]
+					+ (j == 3 ? vp[12 + r] : 0);
+	}
+#endif
+}
+
+#endif
@@ -0,0 +1,125 @@
+/* Consistency check and timing for the mvp_batch kernels
+ *
+ *   ./mvp_bench [--objects N] [--rounds N]
+ *
+ * Checks each TransformKind against a plain 4x4 product of VP and the full
+ * model matrix, then times them and the plain product on N objects.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <vector>
+
+#include "game_logic.h"
+#include "mvp_batch.h"
+
+using namespace std;
+
+/* out = a * b, column-major */
+static void mul4 (const float *a, const float *b, float *out)
+{
+	for (int j=0; j<4; j++)
+		for (int r=0; r<4; r++)
+			out[4*j + r] = a[r] * b[4*j] + a[4 + r] * b[4*j + 1] + a[8 + r] * b[4*j + 2] + a[12 + r] * b[4*j + 3];
+}
+
+/* The full model matrix object i of the batch stands for */
+static void model_matrix (TransformKind kind, const ModelBatch &models, int i, float *m)
+{
+	memset(m, 0, 16 * sizeof(float));
+	m[15] = 1;
+	if (kind == TRANSFORM_AFFINE)
+	{
+		for (int j=0; j<4; j++)
+			for (int r=0; r<3; r++)
+				m[4*j + r] = models.affine[12*i + 3*j + r];
+		return;
+	}
+	float s = kind == TRANSFORM_TRANSLATE_SCALE ? models.scale[i] : 1.0f;
+	m[0] = m[5] = m[10] = s;
+	for (int r=0; r<3; r++)
+		m[12 + r] = models.translation[3*i + r];
+}
+
+static float rand_float (Rng *rng)
+{
+	return (float) rng_range(rng, 2001) / 100.0f - 10.0f;
+}
+
+template <TransformKind Kind>
+static int check_and_time (const char *name, const float *vp, const ModelBatch &models, int objects, int rounds, float *mvp)
+{
+	mvp_batch<Kind>(vp, models, objects, mvp);
+	int bad = 0;
+	for (int i=0; i<objects; i++)
+	{
+		float m[16], expect[16];
+		model_matrix(Kind, models, i, m);
+		mul4(vp, m, expect);
+		for (int k=0; k<16; k++)
+			if (fabsf(expect[k] - mvp[16*i + k]) > 1e-3f * (1 + fabsf(expect[k])))
+			{
+				bad++;
+				break;
+			}
+	}
+
+	auto start = chrono::steady_clock::now();
+	for (int round=0; round<rounds; round++)
+		mvp_batch<Kind>(vp, models, objects, mvp);
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	printf("%-16s %s, %.2f ns/object\n", name, bad ? "MISMATCH" : "ok", 1e9 * seconds / ((double) rounds * objects));
+	return bad;
+}
+
+int main (int argc, char** argv)
+{
+	int objects = 4096, rounds = 2000;
+	for (int i=1; i+1<argc; i+=2)
+	{
+		if (!strcmp(argv[i], "--objects"))
+			objects = atoi(argv[i+1]);
+		else if (!strcmp(argv[i], "--rounds"))
+			rounds = atoi(argv[i+1]);
+	}
+	if (objects < 1 || rounds < 1)
+	{
+		fprintf(stderr, "usage: %s [--objects N] [--rounds N]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	Rng rng;
+	rng_seed(&rng, 42);
+	float vp[16];
+	for (int k=0; k<16; k++)
+		vp[k] = rand_float(&rng);
+	vector<float> translation(3 * objects), scale(objects), affine(12 * objects), mvp(16 * objects);
+	for (size_t k=0; k<translation.size(); k++)
+		translation[k] = rand_float(&rng);
+	for (int k=0; k<objects; k++)
+		scale[k] = rand_float(&rng);
+	for (size_t k=0; k<affine.size(); k++)
+		affine[k] = rand_float(&rng);
+	ModelBatch models = { &translation[0], &scale[0], &affine[0] };
+
+	int bad = check_and_time<TRANSFORM_TRANSLATE>("translate", vp, models, objects, rounds, &mvp[0]);
+	bad += check_and_time<TRANSFORM_TRANSLATE_SCALE>("translate+scale", vp, models, objects, rounds, &mvp[0]);
+	bad += check_and_time<TRANSFORM_AFFINE>("affine", vp, models, objects, rounds, &mvp[0]);
+
+	// What the kernels replace: build the model matrix, then a full product
+	auto start = chrono::steady_clock::now();
+	for (int round=0; round<rounds; round++)
+		for (int i=0; i<objects; i++)
+		{
+			float m[16];
+			model_matrix(TRANSFORM_TRANSLATE, models, i, m);
+			mul4(vp, m, &mvp[16*i]);
+		}
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	printf("%-16s %.2f ns/object\n", "full mat4", 1e9 * seconds / ((double) rounds * objects));
+
+	return bad ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,206 @@
+/* Render the game's board without a GPU, for CI and golden-image checks
+ *
+ *   ./render_frame --seed N [--out frame.ppm] [--compare golden.ppm] [--tolerance N]
+ *                  [--view MODE] [--size WxH] [--threads N] [--frames N]
+ *
+ * Builds the layout from the seed like the game does at startup (player on
+ * the start tile, moving tiles level) and draws it with soft_raster using
+ * the game's meshes and Camera; MODE is one of camera_mode_names. --compare exits with status 1
+ * if any pixel channel differs from the golden image by more than the
+ * tolerance; --frames N renders N times and reports the time per frame.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <vector>
+
+#include "camera.h"
+#include "game_logic.h"
+#include "mvp_batch.h"
+#include "scene_geometry.h"
+#include "soft_raster.h"
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <glm/gtx/transform.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace std;
+
+static void usage (const char *prog)
+{
+	fprintf(stderr, "usage: %s --seed N [--out FILE.ppm] [--compare FILE.ppm] [--tolerance N]\n"
+			"          [--view tower|top|player|follow|helicopter] [--size WxH] [--threads N] [--frames N]\n", prog);
+	exit(EXIT_FAILURE);
+}
+
+/* One MVP per translation with the batched kernel, then draw each */
+static void draw_all (SoftRaster *r, const MeshData *mesh, Camera *camera, const vector<float> &translations)
+{
+	int count = translations.size() / 3;
+	if (count == 0)
+		return;
+	vector<float> mvp(16 * count);
+	ModelBatch models = { &translations[0], NULL, NULL };
+	mvp_batch<TRANSFORM_TRANSLATE>(&camera->view_projection()[0][0], models, count, &mvp[0]);
+	for (int i=0; i<count; i++)
+		soft_draw(r, mesh, &mvp[16*i]);
+}
+
+/* Queue a copy of mesh at (x, y, z) unless it is outside the view, like draw() */
+static void add (vector<float> *translations, Camera *camera, const MeshData *mesh, float x, float y, float z)
+{
+	float min[3], max[3];
+	mesh_bounds(mesh, min, max);
+	glm::vec3 at(x, y, z);
+	if (!camera->box_visible(at + glm::vec3(min[0], min[1], min[2]), at + glm::vec3(max[0], max[1], max[2])))
+		return;
+	translations->push_back(x);
+	translations->push_back(y);
+	translations->push_back(z);
+}
+
+/* Same scene as draw() in Sample_GL3_3D.cpp for a state without motion */
+static void render (SoftRaster *r, const Layout &layout, const GameState &game, Camera *camera)
+{
+	vector<float> player, tiles, obstacles;
+	add(&player, camera, &player_mesh, game.pos_x, game.pos_y, 1);
+	for (int i=0; i<BOARD_SIZE; i++)
+		for (int j=0; j<BOARD_SIZE; j++)
+		{
+			if (layout.holes[i] != j && layout.moving[i] != j)
+				add(&tiles, camera, &floor_mesh, i, j, 0);
+			if (layout.moving[i] == j && layout.moving[i] != layout.obstacles[i])
+				add(&tiles, camera, &floor_mesh, i, j, 0);
+			if (layout.obstacles[i] == j)
+				add(&obstacles, camera, &obstacle_mesh, i, j, 1.5f);
+		}
+
+	soft_clear(r, 0.3f, 0.3f, 0.3f);
+	draw_all(r, &player_mesh, camera, player);
+	draw_all(r, &floor_mesh, camera, tiles);
+	draw_all(r, &obstacle_mesh, camera, obstacles);
+	soft_finish(r);
+}
+
+/* Binary PPM as written by soft_write_ppm */
+static bool read_ppm (const char *path, int *width, int *height, vector<unsigned char> *rgb)
+{
+	FILE *fp = fopen(path, "rb");
+	if (!fp)
+		return false;
+	int max = 0;
+	bool ok = fscanf(fp, "P6 %d %d %d", width, height, &max) == 3 && max == 255 && fgetc(fp) != EOF;
+	if (ok)
+	{
+		rgb->resize((size_t) 3 * *width * *height);
+		ok = fread(&(*rgb)[0], 1, rgb->size(), fp) == rgb->size();
+	}
+	fclose(fp);
+	return ok;
+}
+
+int main (int argc, char** argv)
+{
+	unsigned long long seed = 0;
+	int have_seed = 0;
+	const char *out_path = NULL, *golden_path = NULL;
+	int tolerance = 0, width = 1000, height = 1000, threads = 0, frames = 1, mode = CAMERA_TOWER;
+
+	for (int i=1; i<argc; i++)
+	{
+		const char *arg = argv[i];
+		if (i+1 >= argc)
+			usage(argv[0]);
+		const char *val = argv[++i];
+		if (!strcmp(arg, "--seed"))
+		{
+			seed = strtoull(val, NULL, 10);
+			have_seed = 1;
+		}
+		else if (!strcmp(arg, "--out"))
+			out_path = val;
+		else if (!strcmp(arg, "--compare"))
+			golden_path = val;
+		else if (!strcmp(arg, "--tolerance"))
+			tolerance = atoi(val);
+		else if (!strcmp(arg, "--view"))
+		{
+			mode = camera_mode_from_name(val);
+			if (mode < 0)
+				usage(argv[0]);
+		}
+		else if (!strcmp(arg, "--size"))
+		{
+			if (sscanf(val, "%dx%d", &width, &height) != 2)
+				usage(argv[0]);
+		}
+		else if (!strcmp(arg, "--threads"))
+			threads = atoi(val);
+		else if (!strcmp(arg, "--frames"))
+			frames = atoi(val);
+		else
+			usage(argv[0]);
+	}
+	if (!have_seed || width < 1 || height < 1 || frames < 1)
+		usage(argv[0]);
+
+	Layout layout;
+	layout_from_seed(&layout, seed);
+	GameState game;
+	game_reset(&game);
+
+	// The game's camera with no scrolling or dragging
+	Camera camera;
+	camera.set_aspect(width, height);
+	camera.set_pose(camera_pose((CameraMode) mode, 0, 0, 0, game.pos_x, game.pos_y));
+
+	SoftRaster r;
+	soft_create(&r, width, height, threads);
+	auto start = chrono::steady_clock::now();
+	for (int f=0; f<frames; f++)
+		render(&r, layout, game, &camera);
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	if (frames > 1)
+		printf("%d frames of %dx%d, %.3f ms/frame\n", frames, width, height, 1000 * seconds / frames);
+
+	int status = EXIT_SUCCESS;
+	if (out_path && !soft_write_ppm(&r, out_path))
+	{
+		fprintf(stderr, "Error: can't write %s\n", out_path);
+		status = EXIT_FAILURE;
+	}
+	if (golden_path)
+	{
+		int gw, gh;
+		vector<unsigned char> golden;
+		if (!read_ppm(golden_path, &gw, &gh, &golden) || gw != width || gh != height)
+		{
+			fprintf(stderr, "Error: %s is missing, unreadable or not %dx%d\n", golden_path, width, height);
+			status = EXIT_FAILURE;
+		}
+		else
+		{
+			long diff = 0;
+			for (int y=0; y<height; y++)
+				for (int x=0; x<width; x++)
+				{
+					uint32_t c = r.color[(size_t) y * r.stride + x];
+					const unsigned char *g = &golden[3 * ((size_t) y * width + x)];
+					for (int k=0; k<3; k++)
+						if (abs((int) ((c >> (8*k)) & 0xFF) - g[k]) > tolerance)
+						{
+							diff++;
+							break;
+						}
+				}
+			printf("%ld pixels differ from %s\n", diff, golden_path);
+			if (diff)
+				status = EXIT_FAILURE;
+		}
+	}
+	soft_destroy(&r);
+	return status;
+}
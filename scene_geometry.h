@@ -0,0 +1,22 @@
+#ifndef SCENE_GEOMETRY_H
+#define SCENE_GEOMETRY_H
+
+/* Vertex data of the game's meshes, kept free of GL so the software
+ * rasterizer (soft_raster.h) draws exactly what create3DObject uploads.
+ * Non-indexed triangles; 3 floats per vertex for position and for colour.
+ */
+
+struct MeshData {
+	const float *vertices;
+	const float *colors;
+	int num_vertices;
+};
+
+extern const MeshData floor_mesh;    // one board tile, a tall column reaching z = -9.5
+extern const MeshData player_mesh;   // white unit cube
+extern const MeshData obstacle_mesh; // black unit cube
+
+/* Axis-aligned bounds of a mesh's vertices */
+void mesh_bounds (const MeshData *mesh, float min[3], float max[3]);
+
+#endif
@@ -0,0 +1,145 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "hash.h"
+#include "shader_cache.h"
+
+using namespace std;
+
+#define CACHE_MAGIC 0x53334443u // "S3DC"
+
+struct CacheHeader {
+	uint32_t magic;
+	uint32_t format; // binary format from glGetProgramBinary
+	uint64_t key;    // repeated here to catch hash-named files being swapped
+	uint32_t length;
+	uint32_t pad;
+};
+
+static string cache_dir ()
+{
+	const char *dir = getenv("SAMPLE3D_SHADER_CACHE");
+	if (dir && *dir)
+		return dir;
+	dir = getenv("XDG_CACHE_HOME");
+	if (dir && *dir)
+		return string(dir) + "/sample3D";
+	dir = getenv("HOME");
+	if (dir && *dir)
+		return string(dir) + "/.cache/sample3D";
+	return ".shader_cache";
+}
+
+static string cache_path (uint64_t key)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long) key);
+	return cache_dir() + name;
+}
+
+/* mkdir -p, ignoring components that already exist */
+static void make_dirs (const string &path)
+{
+	for (size_t i=1; i<=path.size(); i++)
+		if (i == path.size() || path[i] == '/')
+			mkdir(path.substr(0, i).c_str(), 0755);
+}
+
+bool shader_cache_supported ()
+{
+	if (!GLAD_GL_ARB_get_program_binary)
+		return false;
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	return formats > 0;
+}
+
+uint64_t shader_cache_key (uint64_t vertex_hash, uint64_t fragment_hash)
+{
+	uint64_t h = hash_bytes(&vertex_hash, sizeof(vertex_hash));
+	h = hash_bytes(&fragment_hash, sizeof(fragment_hash), h);
+	const GLenum driver[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+	for (int i=0; i<3; i++)
+	{
+		const char *s = (const char*) glGetString(driver[i]);
+		if (s)
+			h = hash_bytes(s, strlen(s) + 1, h);
+	}
+	return h;
+}
+
+GLuint shader_cache_load (uint64_t key)
+{
+	FILE *fp = fopen(cache_path(key).c_str(), "rb");
+	if (!fp)
+		return 0;
+
+	CacheHeader header;
+	vector<char> binary;
+	bool ok = fread(&header, sizeof(header), 1, fp) == 1
+		&& header.magic == CACHE_MAGIC && header.key == key && header.length > 0;
+	if (ok)
+	{
+		binary.resize(header.length);
+		ok = fread(&binary[0], 1, binary.size(), fp) == binary.size();
+	}
+	fclose(fp);
+	if (!ok)
+		return 0;
+
+	GLuint program = glCreateProgram();
+	glProgramBinary(program, header.format, &binary[0], (GLsizei) binary.size());
+	GLint status = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (status != GL_TRUE)
+	{
+		// Driver rejected it (format changed under the same version string)
+		glDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+void shader_cache_store (uint64_t key, GLuint program)
+{
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	vector<char> binary(length);
+	GLenum format = 0;
+	GLsizei written = 0;
+	glGetProgramBinary(program, length, &written, &format, &binary[0]);
+	if (written <= 0)
+		return;
+
+	CacheHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = CACHE_MAGIC;
+	header.format = format;
+	header.key = key;
+	header.length = (uint32_t) written;
+
+	// Write then rename, so instances starting together never read half a file
+	string dir = cache_dir();
+	make_dirs(dir);
+	string path = cache_path(key);
+	char suffix[32];
+	snprintf(suffix, sizeof(suffix), ".%d.tmp", (int) getpid());
+	string tmp = path + suffix;
+	FILE *fp = fopen(tmp.c_str(), "wb");
+	if (!fp)
+		return;
+	bool ok = fwrite(&header, sizeof(header), 1, fp) == 1
+		&& fwrite(&binary[0], 1, written, fp) == (size_t) written;
+	ok = fclose(fp) == 0 && ok;
+	if (!ok || rename(tmp.c_str(), path.c_str()) != 0)
+		remove(tmp.c_str());
+}
@@ -0,0 +1,27 @@
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+#include <stdint.h>
+#include <glad/glad.h>
+
+/* On-disk cache of linked program binaries (glGetProgramBinary).
+ *
+ * Entries are keyed by the shader source hashes and the driver
+ * strings (GL_VENDOR, GL_RENDERER, GL_VERSION), so a driver update or an
+ * edited shader simply misses. The directory is $SAMPLE3D_SHADER_CACHE,
+ * else $XDG_CACHE_HOME/sample3D, else ~/.cache/sample3D.
+ */
+
+/* Whether the context can save and load program binaries at all */
+bool shader_cache_supported ();
+
+uint64_t shader_cache_key (uint64_t vertex_hash, uint64_t fragment_hash);
+
+/* A linked program from the cache, or 0 on miss, mismatch or failure */
+GLuint shader_cache_load (uint64_t key);
+
+/* Save a linked program; it must have been linked with
+   GL_PROGRAM_BINARY_RETRIEVABLE_HINT set */
+void shader_cache_store (uint64_t key, GLuint program);
+
+#endif
@@ -0,0 +1,401 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "hash.h"
+#include "log.h"
+#include "shader_cache.h"
+#include "shader_loader.h"
+#include "shader_registry.h"
+
+using namespace std;
+
+/* Print a shader or program info log, if the driver produced one. These
+   can be long, so they go to stderr directly rather than through LOG */
+static void print_info_log (const std::vector<char> &log)
+{
+	if (log.size() > 1 && log[0] != '\0')
+		fprintf(stderr, "%s\n", &log[0]);
+}
+
+static void print_shader_log (GLuint ShaderID)
+{
+	int InfoLogLength = 0;
+	glGetShaderiv(ShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+	std::vector<char> ShaderErrorMessage( max(InfoLogLength, int(1)) );
+	glGetShaderInfoLog(ShaderID, InfoLogLength, NULL, &ShaderErrorMessage[0]);
+	print_info_log(ShaderErrorMessage);
+}
+
+/* Put defines right after the #version line (which must stay first), and
+   reset the line count so compiler messages match the file */
+static void inject_defines (std::string *code, const std::string &defines)
+{
+	if (defines.empty())
+		return;
+	size_t at = 0;
+	int line = 1;
+	if (code->compare(0, 8, "#version") == 0) {
+		at = code->find('\n');
+		at = at == std::string::npos ? code->size() : at + 1;
+		line = 2;
+	}
+	char reset[32];
+	snprintf(reset, sizeof(reset), "#line %d\n", line);
+	code->insert(at, defines + reset);
+}
+
+void shader_program_begin (const char *vertex_shader_name, const char *fragment_shader_name,
+		const std::string &defines, PendingProgram *pending)
+{
+	pending->vertex_name = vertex_shader_name;
+	pending->fragment_name = fragment_shader_name;
+	pending->vertex_shader = pending->fragment_shader = 0;
+
+	// Sources are embedded at build time; no file I/O unless $SAMPLE3D_SHADER_DIR is set
+	std::string VertexShaderCode, FragmentShaderCode;
+	uint64_t VertexShaderHash, FragmentShaderHash;
+	if (!shader_source(vertex_shader_name, &VertexShaderCode, &VertexShaderHash)
+			|| !shader_source(fragment_shader_name, &FragmentShaderCode, &FragmentShaderHash)) {
+		fprintf(stderr, "Error: shader %s or %s is not embedded\n", vertex_shader_name, fragment_shader_name);
+		exit(EXIT_FAILURE);
+	}
+	inject_defines(&VertexShaderCode, defines);
+	inject_defines(&FragmentShaderCode, defines);
+	if (!defines.empty()) {
+		// Each variant gets its own cache entry
+		VertexShaderHash = hash_bytes(defines.data(), defines.size(), VertexShaderHash);
+		FragmentShaderHash = hash_bytes(defines.data(), defines.size(), FragmentShaderHash);
+	}
+
+	// Reuse the program binary from an earlier run if the driver still accepts it
+	pending->use_cache = shader_cache_supported();
+	pending->cache_key = 0;
+	if (pending->use_cache) {
+		pending->cache_key = shader_cache_key(VertexShaderHash, FragmentShaderHash);
+		pending->program = shader_cache_load(pending->cache_key);
+		if (pending->program)
+			return;
+	}
+
+	// Create the shaders
+	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
+	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+
+	// Compile Vertex Shader
+	LOG(LOG_INFO, "Compiling shader : %s", vertex_shader_name);
+	char const * VertexSourcePointer = VertexShaderCode.c_str();
+	glShaderSource(VertexShaderID, 1, &VertexSourcePointer , NULL);
+	glCompileShader(VertexShaderID);
+
+	// Compile Fragment Shader
+	LOG(LOG_INFO, "Compiling shader : %s", fragment_shader_name);
+	char const * FragmentSourcePointer = FragmentShaderCode.c_str();
+	glShaderSource(FragmentShaderID, 1, &FragmentSourcePointer , NULL);
+	glCompileShader(FragmentShaderID);
+
+	// Link the program; status is only queried in finish, so a driver
+	// with parallel compilation doesn't have to block here
+	LOG(LOG_INFO, "Linking program");
+	GLuint ProgramID = glCreateProgram();
+	glAttachShader(ProgramID, VertexShaderID);
+	glAttachShader(ProgramID, FragmentShaderID);
+	if (pending->use_cache)
+		glProgramParameteri(ProgramID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(ProgramID);
+
+	pending->program = ProgramID;
+	pending->vertex_shader = VertexShaderID;
+	pending->fragment_shader = FragmentShaderID;
+}
+
+bool shader_program_ready (const PendingProgram *pending)
+{
+	if (!GLAD_GL_ARB_parallel_shader_compile || !pending->vertex_shader)
+		return true;
+	GLint Done = GL_TRUE;
+	glGetProgramiv(pending->program, GL_COMPLETION_STATUS_ARB, &Done);
+	return Done == GL_TRUE;
+}
+
+GLuint shader_program_finish (PendingProgram *pending)
+{
+	GLuint ProgramID = pending->program;
+	if (!pending->vertex_shader)
+		return ProgramID; // from the cache, already checked
+
+	// Check the shaders and the program
+	print_shader_log(pending->vertex_shader);
+	print_shader_log(pending->fragment_shader);
+	GLint Result = GL_FALSE;
+	int InfoLogLength = 0;
+	glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
+	glGetProgramiv(ProgramID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+	std::vector<char> ProgramErrorMessage( max(InfoLogLength, int(1)) );
+	glGetProgramInfoLog(ProgramID, InfoLogLength, NULL, &ProgramErrorMessage[0]);
+	print_info_log(ProgramErrorMessage);
+
+	glDetachShader(ProgramID, pending->vertex_shader);
+	glDetachShader(ProgramID, pending->fragment_shader);
+	glDeleteShader(pending->vertex_shader);
+	glDeleteShader(pending->fragment_shader);
+	pending->vertex_shader = pending->fragment_shader = 0;
+
+	if (Result != GL_TRUE) {
+		LOG(LOG_ERROR, "linking %s + %s failed", pending->vertex_name, pending->fragment_name);
+		glDeleteProgram(ProgramID);
+		return 0;
+	}
+	if (pending->use_cache)
+		shader_cache_store(pending->cache_key, ProgramID);
+	return ProgramID;
+}
+
+/* Function to load Shaders - Use it as it is */
+GLuint LoadShaders(const char * vertex_shader_name,const char * fragment_shader_name, const std::string &defines)
+{
+	PendingProgram pending;
+	shader_program_begin(vertex_shader_name, fragment_shader_name, defines, &pending);
+	return shader_program_finish(&pending);
+}
+
+
+/* Asynchronous builds */
+
+struct AsyncBuild {
+	string vertex_name, fragment_name, defines;
+	uint32_t tag;
+};
+
+struct AsyncResult {
+	uint32_t tag;
+	GLuint program;
+	GLsync fence; // signalled once the worker's GL commands for program completed
+};
+
+struct ParallelBuild {
+	uint32_t tag;
+	PendingProgram pending;
+};
+
+static bool use_parallel;               // ARB_parallel_shader_compile, no worker
+static vector<ParallelBuild> parallel_builds;
+
+static GLFWwindow *worker_window;       // hidden, shares objects with the main context
+static thread worker;
+static mutex worker_mutex;
+static condition_variable worker_wake;
+static bool worker_stop;
+static deque<AsyncBuild> worker_queue;  // also built on poll when there's no worker
+static vector<AsyncResult> worker_results;
+
+static vector<AsyncBuild> builds;       // everything requested, for hot reload
+static int watch_fd = -1;
+
+static void worker_main ()
+{
+	glfwMakeContextCurrent(worker_window);
+	for (;;) {
+		AsyncBuild build;
+		{
+			unique_lock<mutex> lock(worker_mutex);
+			worker_wake.wait(lock, [] { return worker_stop || !worker_queue.empty(); });
+			if (worker_stop)
+				break;
+			build = worker_queue.front();
+			worker_queue.pop_front();
+		}
+
+		GLuint program = LoadShaders(build.vertex_name.c_str(), build.fragment_name.c_str(), build.defines);
+		if (!program)
+			continue; // keep whatever the main thread has
+		GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glFlush(); // make the fence visible to the other context
+
+		lock_guard<mutex> lock(worker_mutex);
+		AsyncResult result = { build.tag, program, fence };
+		worker_results.push_back(result);
+	}
+	glfwMakeContextCurrent(NULL);
+}
+
+void shader_async_init (GLFWwindow *window)
+{
+	use_parallel = GLAD_GL_ARB_parallel_shader_compile != 0;
+	if (use_parallel) {
+		glMaxShaderCompilerThreadsARB(0xFFFFFFFFu); // let the driver pick
+	}
+	else {
+		// Same context hints as initGLFW, still set; just don't show it
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		worker_window = glfwCreateWindow(1, 1, "shader compiler", NULL, window);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+		if (worker_window) {
+			worker_stop = false;
+			worker = thread(worker_main);
+		}
+	}
+
+#ifdef __linux__
+	const char *dir = getenv("SAMPLE3D_SHADER_DIR");
+	if (dir && *dir) {
+		watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (watch_fd >= 0 && inotify_add_watch(watch_fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+			close(watch_fd);
+			watch_fd = -1;
+		}
+	}
+#endif
+}
+
+static void start_build (const AsyncBuild &build)
+{
+	if (use_parallel) {
+		ParallelBuild parallel;
+		parallel.tag = build.tag;
+		shader_program_begin(build.vertex_name.c_str(), build.fragment_name.c_str(), build.defines, &parallel.pending);
+		parallel_builds.push_back(parallel);
+		return;
+	}
+	lock_guard<mutex> lock(worker_mutex);
+	// A queued build with the same tag is out of date
+	for (size_t i=0; i<worker_queue.size(); i++)
+		if (worker_queue[i].tag == build.tag) {
+			worker_queue[i] = build;
+			return;
+		}
+	worker_queue.push_back(build);
+	worker_wake.notify_one();
+}
+
+void shader_async_request (const char *vertex_shader_name, const char *fragment_shader_name,
+		const std::string &defines, uint32_t tag)
+{
+	AsyncBuild build = { vertex_shader_name, fragment_shader_name, defines, tag };
+	size_t i = 0;
+	while (i < builds.size() && builds[i].tag != tag)
+		i++;
+	if (i == builds.size())
+		builds.push_back(build);
+	else
+		builds[i] = build;
+	start_build(build);
+}
+
+/* Rebuild every requested program that uses a file which was written */
+static void check_watch ()
+{
+#ifdef __linux__
+	if (watch_fd < 0)
+		return;
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	vector<string> changed;
+	ssize_t len;
+	while ((len = read(watch_fd, buf, sizeof(buf))) > 0) {
+		for (char *p = buf; p < buf + len; ) {
+			struct inotify_event *event = (struct inotify_event*) p;
+			if (event->len)
+				changed.push_back(event->name);
+			p += sizeof(struct inotify_event) + event->len;
+		}
+	}
+	for (size_t i=0; i<builds.size(); i++)
+		for (size_t j=0; j<changed.size(); j++)
+			if (builds[i].vertex_name == changed[j] || builds[i].fragment_name == changed[j]) {
+				LOG(LOG_INFO, "Reloading shaders %s, %s", builds[i].vertex_name, builds[i].fragment_name);
+				start_build(builds[i]);
+				break;
+			}
+#endif
+}
+
+bool shader_async_poll (uint32_t *tag, GLuint *program)
+{
+	check_watch();
+
+	if (use_parallel) {
+		for (size_t i=0; i<parallel_builds.size(); i++) {
+			if (!shader_program_ready(&parallel_builds[i].pending))
+				continue;
+			*tag = parallel_builds[i].tag;
+			*program = shader_program_finish(&parallel_builds[i].pending);
+			parallel_builds.erase(parallel_builds.begin() + i);
+			if (*program)
+				return true;
+			i--; // failed to link; keep the current program
+		}
+		return false;
+	}
+
+	if (!worker_window) {
+		// No shared context available: build synchronously, one per call
+		while (!worker_queue.empty()) {
+			AsyncBuild build = worker_queue.front();
+			worker_queue.pop_front();
+			*tag = build.tag;
+			*program = LoadShaders(build.vertex_name.c_str(), build.fragment_name.c_str(), build.defines);
+			if (*program)
+				return true;
+		}
+		return false;
+	}
+
+	unique_lock<mutex> lock(worker_mutex, try_to_lock);
+	if (!lock.owns_lock())
+		return false;
+	for (size_t i=0; i<worker_results.size(); i++) {
+		// Only hand a program over once the worker's commands have completed
+		GLenum status = glClientWaitSync(worker_results[i].fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			continue;
+		glDeleteSync(worker_results[i].fence);
+		*tag = worker_results[i].tag;
+		*program = worker_results[i].program;
+		worker_results.erase(worker_results.begin() + i);
+		return true;
+	}
+	return false;
+}
+
+void shader_async_shutdown ()
+{
+	if (worker_window) {
+		{
+			lock_guard<mutex> lock(worker_mutex);
+			worker_stop = true;
+			worker_wake.notify_one();
+		}
+		worker.join();
+		glfwDestroyWindow(worker_window);
+		worker_window = NULL;
+	}
+	for (size_t i=0; i<worker_results.size(); i++) {
+		glDeleteProgram(worker_results[i].program);
+		glDeleteSync(worker_results[i].fence);
+	}
+	worker_results.clear();
+	worker_queue.clear();
+	for (size_t i=0; i<parallel_builds.size(); i++) {
+		GLuint program = shader_program_finish(&parallel_builds[i].pending);
+		if (program)
+			glDeleteProgram(program);
+	}
+	parallel_builds.clear();
+	builds.clear();
+#ifdef __linux__
+	if (watch_fd >= 0) {
+		close(watch_fd);
+		watch_fd = -1;
+	}
+#endif
+}
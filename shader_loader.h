@@ -0,0 +1,52 @@
+#ifndef SHADER_LOADER_H
+#define SHADER_LOADER_H
+
+#include <stdint.h>
+#include <string>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+/* Build a program from two registry shaders (see shader_registry.h),
+   going through the program binary cache. defines ("#define X 1\n"...)
+   are inserted after #version in both. Returns 0 if it fails to link. */
+GLuint LoadShaders(const char * vertex_shader_name,const char * fragment_shader_name,
+		const std::string &defines = std::string());
+
+/* A program build split in two, so the driver can compile in the
+   background between begin and finish */
+struct PendingProgram {
+	GLuint program;
+	GLuint vertex_shader, fragment_shader; // 0 when loaded from the cache
+	bool use_cache;
+	uint64_t cache_key;
+	std::string vertex_name, fragment_name;
+};
+
+void shader_program_begin (const char *vertex_shader_name, const char *fragment_shader_name,
+		const std::string &defines, PendingProgram *pending);
+/* Whether finish would not block (always true without ARB_parallel_shader_compile) */
+bool shader_program_ready (const PendingProgram *pending);
+/* Check status, print logs and store in the cache; 0 if linking failed */
+GLuint shader_program_finish (PendingProgram *pending);
+
+/* Asynchronous builds, so the first frame (and shader edits) never wait
+ * for the compiler.
+ *
+ * With ARB_parallel_shader_compile the driver compiles in the background
+ * and completion is polled; otherwise a worker thread builds the program
+ * on a hidden context sharing objects with the main one, and hands it
+ * over with a fence. If $SAMPLE3D_SHADER_DIR is set, edited files there
+ * are rebuilt the same way (inotify, Linux only).
+ *
+ * Each request carries a caller-chosen tag; a later request with the same
+ * tag replaces it. All calls are from the thread owning the main context.
+ */
+void shader_async_init (GLFWwindow *window);
+void shader_async_request (const char *vertex_shader_name, const char *fragment_shader_name,
+		const std::string &defines, uint32_t tag);
+/* Call until false, once per frame: each true is a newly built program
+   (caller owns it) for the request with that tag */
+bool shader_async_poll (uint32_t *tag, GLuint *program);
+void shader_async_shutdown ();
+
+#endif
@@ -0,0 +1,115 @@
+#include <cstdio>
+#include <cstring>
+
+#include "shader_reflect.h"
+
+using namespace std;
+
+static void table_clear (ReflectTable *table)
+{
+	memset(table, 0, sizeof(*table));
+}
+
+static void table_insert (ReflectTable *table, const char *name, GLint location, GLenum type, GLint size)
+{
+	// "lights[0]" is reported for arrays; store it as "lights"
+	size_t len = strlen(name);
+	const char *bracket = strchr(name, '[');
+	if (bracket)
+		len = bracket - name;
+	uint64_t hash = hash_bytes(name, len);
+
+	if (table->count >= REFLECT_SLOTS - 1) {
+		fprintf(stderr, "Shader reflection: more than %d entries, %.*s dropped\n", REFLECT_SLOTS - 1, (int) len, name);
+		return;
+	}
+	unsigned i = (unsigned) hash & (REFLECT_SLOTS - 1);
+	while (table->slot[i].hash && table->slot[i].hash != hash)
+		i = (i + 1) & (REFLECT_SLOTS - 1);
+	ReflectEntry &e = table->slot[i];
+	if (!e.hash)
+		table->count++;
+	e.hash = hash;
+	e.location = location;
+	e.type = type;
+	e.size = size;
+	snprintf(e.name, sizeof(e.name), "%.*s", (int) len, name);
+}
+
+const ReflectEntry *reflect_find (const ReflectTable *table, uint64_t hash)
+{
+	// Never full (see table_insert), so the probe always reaches an empty slot
+	for (unsigned i = (unsigned) hash & (REFLECT_SLOTS - 1); table->slot[i].hash; i = (i + 1) & (REFLECT_SLOTS - 1))
+		if (table->slot[i].hash == hash)
+			return &table->slot[i];
+	return NULL;
+}
+
+void shader_reflect (GLuint program, ShaderReflection *reflection)
+{
+	table_clear(&reflection->uniforms);
+	table_clear(&reflection->blocks);
+	table_clear(&reflection->attributes);
+
+	char name[256];
+	GLint count = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+	for (GLint i=0; i<count; i++) {
+		GLint size;
+		GLenum type;
+		glGetActiveUniform(program, i, sizeof(name), NULL, &size, &type, name);
+		GLint location = glGetUniformLocation(program, name);
+		if (location >= 0) // -1: member of a uniform block
+			table_insert(&reflection->uniforms, name, location, type, size);
+	}
+
+	count = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+	for (GLint i=0; i<count; i++) {
+		GLint data_size = 0;
+		glGetActiveUniformBlockName(program, i, sizeof(name), NULL, name);
+		glGetActiveUniformBlockiv(program, i, GL_UNIFORM_BLOCK_DATA_SIZE, &data_size);
+		table_insert(&reflection->blocks, name, i, 0, data_size);
+	}
+
+	count = 0;
+	glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+	for (GLint i=0; i<count; i++) {
+		GLint size;
+		GLenum type;
+		glGetActiveAttrib(program, i, sizeof(name), NULL, &size, &type, name);
+		if (strncmp(name, "gl_", 3) == 0)
+			continue; // built-ins like gl_VertexID have no location
+		table_insert(&reflection->attributes, name, glGetAttribLocation(program, name), type, size);
+	}
+}
+
+bool shader_check_vertex_layout (const ShaderReflection *reflection, const VertexAttribute *layout, int count,
+		const char *program_name)
+{
+	bool ok = true;
+	const ReflectTable &inputs = reflection->attributes;
+	for (int i=0; i<REFLECT_SLOTS; i++) {
+		const ReflectEntry &input = inputs.slot[i];
+		if (!input.hash)
+			continue;
+		int j = 0;
+		while (j < count && hash_str(layout[j].name) != input.hash)
+			j++;
+		if (j == count) {
+			fprintf(stderr, "%s: vertex input %s is not in the vertex layout\n", program_name, input.name);
+			ok = false;
+		}
+		else if (layout[j].location != input.location) {
+			fprintf(stderr, "%s: vertex input %s is at location %d, the vertex layout puts it at %d\n",
+					program_name, input.name, input.location, layout[j].location);
+			ok = false;
+		}
+		else if (layout[j].type != input.type) {
+			fprintf(stderr, "%s: vertex input %s has type 0x%x, the vertex layout gives 0x%x\n",
+					program_name, input.name, input.type, layout[j].type);
+			ok = false;
+		}
+	}
+	return ok;
+}
@@ -0,0 +1,79 @@
+#ifndef SHADER_REFLECT_H
+#define SHADER_REFLECT_H
+
+#include <stdint.h>
+#include <glad/glad.h>
+
+#include "hash.h"
+
+/* What a linked program actually uses, read once after linking.
+ *
+ * Active uniforms, uniform blocks and vertex inputs go into small
+ * open-addressed tables keyed by the FNV-1a hash of their name, so code
+ * binds with a compile-time constant instead of a string lookup in GL:
+ *   GLint mvp = reflect_uniform(&r, SHADER_NAME("MVP"));
+ * Array uniforms are stored under their base name ("lights", not
+ * "lights[0]"); uniforms inside blocks are only reachable via the block.
+ */
+
+/* Forces the hash to be computed by the compiler */
+template <uint64_t H> struct ShaderNameHash { static constexpr uint64_t value = H; };
+#define SHADER_NAME(s) (ShaderNameHash<hash_str(s)>::value)
+
+#define REFLECT_SLOTS 32    // per table, power of two; programs here have a handful
+#define REFLECT_NAME_MAX 32 // kept for messages only, may be truncated
+
+struct ReflectEntry {
+	uint64_t hash;  // 0 = empty slot
+	GLint location; // uniform/attribute location, or block index
+	GLenum type;    // GL_FLOAT_VEC3 etc.; 0 for blocks
+	GLint size;     // array length, or block data size in bytes
+	char name[REFLECT_NAME_MAX];
+};
+
+struct ReflectTable {
+	ReflectEntry slot[REFLECT_SLOTS];
+	int count;
+};
+
+struct ShaderReflection {
+	ReflectTable uniforms, blocks, attributes;
+};
+
+/* A vertex input as the C++ side sets it up with glVertexAttribPointer */
+struct VertexAttribute {
+	const char *name;
+	GLint location;
+	GLenum type;
+};
+
+void shader_reflect (GLuint program, ShaderReflection *reflection);
+
+/* Entry for a name hash, or NULL if the program doesn't use it */
+const ReflectEntry *reflect_find (const ReflectTable *table, uint64_t hash);
+
+inline GLint reflect_uniform (const ShaderReflection *reflection, uint64_t hash)
+{
+	const ReflectEntry *e = reflect_find(&reflection->uniforms, hash);
+	return e ? e->location : -1;
+}
+
+inline GLint reflect_attribute (const ShaderReflection *reflection, uint64_t hash)
+{
+	const ReflectEntry *e = reflect_find(&reflection->attributes, hash);
+	return e ? e->location : -1;
+}
+
+inline GLint reflect_block (const ShaderReflection *reflection, uint64_t hash)
+{
+	const ReflectEntry *e = reflect_find(&reflection->blocks, hash);
+	return e ? e->location : -1;
+}
+
+/* Report shader inputs the layout doesn't feed, or feeds at another
+   location or with another type. Layout entries the shader doesn't use
+   are fine (other variants may). Returns true if everything matches. */
+bool shader_check_vertex_layout (const ShaderReflection *reflection, const VertexAttribute *layout, int count,
+		const char *program_name);
+
+#endif
@@ -0,0 +1,48 @@
+#include <cstdio>
+#include <cstdlib>
+
+#include "hash.h"
+#include "shader_registry.h"
+
+using namespace std;
+
+static bool read_override (const char *name, string *code)
+{
+	const char *dir = getenv("SAMPLE3D_SHADER_DIR");
+	if (!dir || !*dir)
+		return false;
+	string path = string(dir) + "/" + name;
+	FILE *fp = fopen(path.c_str(), "rb");
+	if (!fp)
+		return false;
+	code->clear();
+	char buf[4096];
+	size_t n;
+	while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+		code->append(buf, n);
+	fclose(fp);
+	return true;
+}
+
+bool shader_source (const char *name, string *code, uint64_t *hash)
+{
+	int index = -1;
+	for (int i=0; i<NUM_EMBEDDED_SHADERS; i++)
+		if (shader_name_equal(embedded_shaders[i].name, name))
+			index = i;
+
+	if (read_override(name, code))
+	{
+		*hash = hash_bytes(code->data(), code->size());
+		if (index < 0)
+			fprintf(stderr, "Shader %s: not embedded, using $SAMPLE3D_SHADER_DIR copy\n", name);
+		else if (*hash != embedded_shaders[index].hash)
+			fprintf(stderr, "Shader %s: $SAMPLE3D_SHADER_DIR copy differs from the embedded build\n", name);
+		return true;
+	}
+	if (index < 0)
+		return false;
+	code->assign(embedded_shaders[index].code, embedded_shaders[index].length);
+	*hash = embedded_shaders[index].hash;
+	return true;
+}
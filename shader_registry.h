@@ -0,0 +1,43 @@
+#ifndef SHADER_REGISTRY_H
+#define SHADER_REGISTRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+/* Shader sources compiled into the binary by embed_shaders (see Makefile).
+ *
+ * Lookups by name can be checked at compile time:
+ *   static_assert(shader_index("Sample_GL.vert") >= 0, "not embedded");
+ *
+ * For development, $SAMPLE3D_SHADER_DIR overrides the embedded copies
+ * with files of the same name from that directory.
+ */
+
+struct ShaderSource {
+	const char *name;
+	const char *code;
+	size_t length;
+	uint64_t hash; // FNV-1a of code, computed at build time
+};
+
+#include "shaders_embedded.h"
+
+constexpr int NUM_EMBEDDED_SHADERS = sizeof(embedded_shaders) / sizeof(embedded_shaders[0]);
+
+constexpr bool shader_name_equal (const char *a, const char *b)
+{
+	return *a == *b && (*a == '\0' || shader_name_equal(a + 1, b + 1));
+}
+
+constexpr int shader_index (const char *name, int i = 0)
+{
+	return i >= NUM_EMBEDDED_SHADERS ? -1
+		: shader_name_equal(embedded_shaders[i].name, name) ? i : shader_index(name, i + 1);
+}
+
+/* Source and hash of a shader: the override file if one exists, else the
+   embedded copy. False if neither exists. */
+bool shader_source (const char *name, std::string *code, uint64_t *hash);
+
+#endif
@@ -0,0 +1,75 @@
+#include <cstdio>
+
+#include "shader_loader.h"
+#include "shader_variants.h"
+
+using namespace std;
+
+static const char *vertex_name, *fragment_name;
+static const VertexAttribute *vertex_layout;
+static int vertex_layout_count;
+static ShaderVariant variants[NUM_SHADER_VARIANTS];
+static bool requested[NUM_SHADER_VARIANTS];
+
+string shader_feature_defines (ShaderFeatures features)
+{
+	string defines;
+	for (int i=0; i<NUM_SHADER_FEATURES; i++)
+		if (features.has((ShaderFeature) i))
+			defines += string("#define ") + shader_feature_names[i] + " 1\n";
+	return defines;
+}
+
+void shader_variants_init (GLFWwindow *window, const char *vertex_shader_name, const char *fragment_shader_name,
+		const VertexAttribute *layout, int layout_count)
+{
+	vertex_name = vertex_shader_name;
+	fragment_name = fragment_shader_name;
+	vertex_layout = layout;
+	vertex_layout_count = layout_count;
+	for (int i=0; i<NUM_SHADER_VARIANTS; i++) {
+		variants[i].program.reset();
+		variants[i].mvp = variants[i].tint = -1;
+		requested[i] = false;
+	}
+	shader_async_init(window);
+}
+
+const ShaderVariant *shader_variant (ShaderFeatures features)
+{
+	uint32_t i = features.bits;
+	if (!requested[i]) {
+		requested[i] = true;
+		shader_async_request(vertex_name, fragment_name, shader_feature_defines(features), i);
+	}
+	return variants[i].program ? &variants[i] : NULL;
+}
+
+bool shader_variants_poll ()
+{
+	uint32_t i;
+	GLuint program;
+	bool changed = false;
+	while (shader_async_poll(&i, &program)) {
+		changed = true;
+		ShaderVariant &variant = variants[i];
+		variant.program = GpuProgram(program); // replaces the old one on hot reload
+		shader_reflect(program, &variant.reflection);
+		variant.mvp = reflect_uniform(&variant.reflection, SHADER_NAME("MVP"));
+		variant.tint = reflect_uniform(&variant.reflection, SHADER_NAME("Tint"));
+
+		char name[256];
+		snprintf(name, sizeof(name), "%s + %s, features 0x%x", vertex_name, fragment_name, i);
+		shader_check_vertex_layout(&variant.reflection, vertex_layout, vertex_layout_count, name);
+	}
+	return changed;
+}
+
+void shader_variants_shutdown ()
+{
+	shader_async_shutdown();
+	for (int i=0; i<NUM_SHADER_VARIANTS; i++) {
+		variants[i].program.reset();
+		requested[i] = false;
+	}
+}
@@ -0,0 +1,74 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <stdint.h>
+#include <string>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "gpu_handle.h"
+#include "shader_reflect.h"
+
+/* Shader permutations: one vertex/fragment pair, specialised by feature
+ * flags that become "#define FEATURE_X 1" ahead of compilation.
+ *
+ * A variant is built the first time it's asked for (asynchronously, see
+ * shader_loader.h) and kept per feature bitmask, so a draw only pays for
+ * the features it uses. Feature sets are constexpr, so a fixed variant can
+ * be named at compile time:
+ *   constexpr ShaderFeatures TINTED = ShaderFeatures() | SHADER_TINT;
+ */
+
+enum ShaderFeature {
+	SHADER_INSTANCED, // vec3 instanceOffset at location 2 added to the position
+	SHADER_TINT,      // uniform vec3 Tint multiplies the vertex colour
+	NUM_SHADER_FEATURES
+};
+
+constexpr const char *shader_feature_names[NUM_SHADER_FEATURES] = {
+	"FEATURE_INSTANCED",
+	"FEATURE_TINT",
+};
+
+#define NUM_SHADER_VARIANTS (1 << NUM_SHADER_FEATURES)
+
+struct ShaderFeatures {
+	uint32_t bits;
+
+	constexpr ShaderFeatures () : bits(0) {}
+	constexpr explicit ShaderFeatures (uint32_t bits) : bits(bits) {}
+	constexpr ShaderFeatures (ShaderFeature feature) : bits(1u << feature) {}
+
+	constexpr bool has (ShaderFeature feature) const { return (bits >> feature) & 1; }
+	constexpr ShaderFeatures operator| (ShaderFeatures other) const { return ShaderFeatures(bits | other.bits); }
+	constexpr bool operator== (ShaderFeatures other) const { return bits == other.bits; }
+};
+
+constexpr ShaderFeatures operator| (ShaderFeature a, ShaderFeature b)
+{
+	return ShaderFeatures(a) | ShaderFeatures(b);
+}
+
+struct ShaderVariant {
+	GpuProgram program; // empty until built
+	GLint mvp;      // uniform locations, -1 if the variant doesn't have it
+	GLint tint;
+	ShaderReflection reflection; // anything else, by SHADER_NAME
+};
+
+/* The "#define" block for a feature set */
+std::string shader_feature_defines (ShaderFeatures features);
+
+/* layout is what the meshes provide; every variant's inputs are checked
+   against it when it's built */
+void shader_variants_init (GLFWwindow *window, const char *vertex_shader_name, const char *fragment_shader_name,
+		const VertexAttribute *layout, int layout_count);
+/* The variant for features, or NULL while it's still being built (the
+   first call starts the build) */
+const ShaderVariant *shader_variant (ShaderFeatures features);
+/* Once per frame: take over finished builds, including hot reloads.
+   True if any program changed */
+bool shader_variants_poll ();
+void shader_variants_shutdown ();
+
+#endif
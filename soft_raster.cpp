@@ -0,0 +1,323 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+#include "soft_raster.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+struct ClipVertex {
+	float x, y, z, w;
+};
+
+static void run_tiles (SoftRaster *r);
+
+static void soft_worker (SoftRaster *r)
+{
+	uint64_t seen = 0;
+	for (;;) {
+		{
+			unique_lock<mutex> lock(r->mutex);
+			r->wake.wait(lock, [&] { return r->stop || r->generation != seen; });
+			if (r->stop)
+				return;
+			seen = r->generation;
+		}
+		run_tiles(r);
+		lock_guard<mutex> lock(r->mutex);
+		if (--r->busy == 0)
+			r->done.notify_one();
+	}
+}
+
+void soft_create (SoftRaster *r, int width, int height, int threads)
+{
+	r->width = width;
+	r->height = height;
+	r->tiles_x = (width + SOFT_TILE - 1) / SOFT_TILE;
+	r->tiles_y = (height + SOFT_TILE - 1) / SOFT_TILE;
+	r->stride = r->tiles_x * SOFT_TILE;
+	size_t pixels = (size_t) r->stride * r->tiles_y * SOFT_TILE;
+	r->color = (uint32_t*) aligned_alloc(64, pixels * sizeof(uint32_t));
+	r->depth = (float*) aligned_alloc(64, pixels * sizeof(float));
+	r->bins.assign(r->tiles_x * r->tiles_y, vector<uint32_t>());
+	r->clear_pending = false;
+	r->clear_color = 0xFF000000u;
+	r->generation = 0;
+	r->busy = 0;
+	r->stop = false;
+	r->next_tile = 0;
+
+	if (threads <= 0)
+		threads = max(1, (int) thread::hardware_concurrency());
+	// The thread calling soft_finish works too
+	for (int i=1; i<threads; i++)
+		r->workers.push_back(thread(soft_worker, r));
+}
+
+void soft_destroy (SoftRaster *r)
+{
+	{
+		lock_guard<mutex> lock(r->mutex);
+		r->stop = true;
+		r->wake.notify_all();
+	}
+	for (size_t i=0; i<r->workers.size(); i++)
+		r->workers[i].join();
+	r->workers.clear();
+	free(r->color);
+	free(r->depth);
+	r->color = NULL;
+	r->depth = NULL;
+}
+
+static uint32_t pack_color (float red, float green, float blue)
+{
+	int c[3] = { (int) lroundf(red * 255), (int) lroundf(green * 255), (int) lroundf(blue * 255) };
+	for (int i=0; i<3; i++)
+		c[i] = c[i] < 0 ? 0 : (c[i] > 255 ? 255 : c[i]);
+	return c[0] | c[1] << 8 | c[2] << 16 | 0xFF000000u;
+}
+
+void soft_clear (SoftRaster *r, float red, float green, float blue)
+{
+	// Done per tile in soft_finish, so it's spread over the threads too
+	r->clear_pending = true;
+	r->clear_color = pack_color(red, green, blue);
+}
+
+/* Project to the window, set up edge functions and bin into tiles */
+static void setup_triangle (SoftRaster *r, const ClipVertex v[3], uint32_t color)
+{
+	float sx[3], sy[3], sz[3];
+	for (int i=0; i<3; i++) {
+		float inv_w = 1.0f / v[i].w;
+		sx[i] = (v[i].x * inv_w * 0.5f + 0.5f) * r->width;
+		sy[i] = (0.5f - v[i].y * inv_w * 0.5f) * r->height; // row 0 at the top
+		sz[i] = v[i].z * inv_w * 0.5f + 0.5f;
+	}
+
+	float area = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sx[2] - sx[0]) * (sy[1] - sy[0]);
+	if (fabsf(area) < 1e-8f)
+		return;
+
+	SoftTriangle t;
+	for (int i=0; i<3; i++) {
+		// Edge opposite vertex i, oriented so vertex i is on the inside
+		int p = (i + 1) % 3, q = (i + 2) % 3;
+		t.a[i] = sy[p] - sy[q];
+		t.b[i] = sx[q] - sx[p];
+		t.c[i] = sx[p] * sy[q] - sy[p] * sx[q];
+		if (area < 0) {
+			t.a[i] = -t.a[i];
+			t.b[i] = -t.b[i];
+			t.c[i] = -t.c[i];
+		}
+	}
+	// Each edge function is |area| at its opposite vertex and 0 on the
+	// other two, so z = sum(E_i z_i) / |area|
+	float inv_area = 1.0f / fabsf(area);
+	t.zx = (t.a[0] * sz[0] + t.a[1] * sz[1] + t.a[2] * sz[2]) * inv_area;
+	t.zy = (t.b[0] * sz[0] + t.b[1] * sz[1] + t.b[2] * sz[2]) * inv_area;
+	t.zc = (t.c[0] * sz[0] + t.c[1] * sz[1] + t.c[2] * sz[2]) * inv_area;
+	t.color = color;
+
+	float min_x = min(sx[0], min(sx[1], sx[2])), max_x = max(sx[0], max(sx[1], sx[2]));
+	float min_y = min(sy[0], min(sy[1], sy[2])), max_y = max(sy[0], max(sy[1], sy[2]));
+	t.min_x = max(0, (int) floorf(min_x));
+	t.min_y = max(0, (int) floorf(min_y));
+	t.max_x = min(r->width - 1, (int) ceilf(max_x));
+	t.max_y = min(r->height - 1, (int) ceilf(max_y));
+	if (t.min_x > t.max_x || t.min_y > t.max_y)
+		return;
+
+	uint32_t index = r->triangles.size();
+	r->triangles.push_back(t);
+	for (int ty = t.min_y / SOFT_TILE; ty <= t.max_y / SOFT_TILE; ty++)
+		for (int tx = t.min_x / SOFT_TILE; tx <= t.max_x / SOFT_TILE; tx++)
+			r->bins[ty * r->tiles_x + tx].push_back(index);
+}
+
+/* Near plane (z >= -w) clipping; the others are handled by the pixel
+   bounds and the depth test */
+static void clip_triangle (SoftRaster *r, const ClipVertex v[3], uint32_t color)
+{
+	float d[3];
+	int inside = 0;
+	for (int i=0; i<3; i++) {
+		d[i] = v[i].z + v[i].w;
+		inside += d[i] >= 0;
+	}
+	if (inside == 3) {
+		setup_triangle(r, v, color);
+		return;
+	}
+	if (inside == 0)
+		return;
+
+	ClipVertex out[4];
+	int n = 0;
+	for (int i=0; i<3; i++) {
+		int j = (i + 1) % 3;
+		if (d[i] >= 0)
+			out[n++] = v[i];
+		if ((d[i] >= 0) != (d[j] >= 0)) {
+			float t = d[i] / (d[i] - d[j]);
+			ClipVertex c = {
+				v[i].x + t * (v[j].x - v[i].x), v[i].y + t * (v[j].y - v[i].y),
+				v[i].z + t * (v[j].z - v[i].z), v[i].w + t * (v[j].w - v[i].w)
+			};
+			out[n++] = c;
+		}
+	}
+	setup_triangle(r, out, color);
+	if (n == 4) {
+		ClipVertex second[3] = { out[0], out[2], out[3] };
+		setup_triangle(r, second, color);
+	}
+}
+
+void soft_draw (SoftRaster *r, const MeshData *mesh, const float mvp[16])
+{
+	for (int i=0; i + 2 < mesh->num_vertices; i += 3) {
+		ClipVertex v[3];
+		float rgb[3] = { 0, 0, 0 };
+		for (int k=0; k<3; k++) {
+			const float *p = mesh->vertices + 3*(i + k);
+			const float *c = mesh->colors + 3*(i + k);
+			// Column-major, as glm stores it
+			v[k].x = mvp[0] * p[0] + mvp[4] * p[1] + mvp[8] * p[2] + mvp[12];
+			v[k].y = mvp[1] * p[0] + mvp[5] * p[1] + mvp[9] * p[2] + mvp[13];
+			v[k].z = mvp[2] * p[0] + mvp[6] * p[1] + mvp[10] * p[2] + mvp[14];
+			v[k].w = mvp[3] * p[0] + mvp[7] * p[1] + mvp[11] * p[2] + mvp[15];
+			for (int j=0; j<3; j++)
+				rgb[j] += c[j] * (1.0f / 3);
+		}
+		clip_triangle(r, v, pack_color(rgb[0], rgb[1], rgb[2]));
+	}
+}
+
+static void raster_tile (SoftRaster *r, int tile)
+{
+	int x0 = (tile % r->tiles_x) * SOFT_TILE, y0 = (tile / r->tiles_x) * SOFT_TILE;
+	if (r->clear_pending) {
+		for (int y = y0; y < y0 + SOFT_TILE; y++) {
+			uint32_t *c = r->color + (size_t) y * r->stride + x0;
+			float *z = r->depth + (size_t) y * r->stride + x0;
+			for (int x=0; x<SOFT_TILE; x++) {
+				c[x] = r->clear_color;
+				z[x] = 1.0f;
+			}
+		}
+	}
+
+	const vector<uint32_t> &bin = r->bins[tile];
+	for (size_t n=0; n<bin.size(); n++) {
+		const SoftTriangle &t = r->triangles[bin[n]];
+		// Clip the bounds to the tile; x0 of each row stays 4-aligned
+		int bx0 = max(x0, t.min_x & ~3), bx1 = min(x0 + SOFT_TILE - 1, t.max_x);
+		int by0 = max(y0, t.min_y), by1 = min(y0 + SOFT_TILE - 1, t.max_y);
+
+		for (int y = by0; y <= by1; y++) {
+			float py = y + 0.5f;
+			uint32_t *crow = r->color + (size_t) y * r->stride;
+			float *zrow = r->depth + (size_t) y * r->stride;
+#ifdef __SSE2__
+			const __m128 lane = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+			__m128 a0 = _mm_set1_ps(t.a[0]), a1 = _mm_set1_ps(t.a[1]), a2 = _mm_set1_ps(t.a[2]);
+			__m128 zx = _mm_set1_ps(t.zx);
+			__m128 px = _mm_add_ps(_mm_set1_ps((float) bx0), lane);
+			__m128 e0 = _mm_add_ps(_mm_mul_ps(a0, px), _mm_set1_ps(t.b[0] * py + t.c[0]));
+			__m128 e1 = _mm_add_ps(_mm_mul_ps(a1, px), _mm_set1_ps(t.b[1] * py + t.c[1]));
+			__m128 e2 = _mm_add_ps(_mm_mul_ps(a2, px), _mm_set1_ps(t.b[2] * py + t.c[2]));
+			__m128 z = _mm_add_ps(_mm_mul_ps(zx, px), _mm_set1_ps(t.zy * py + t.zc));
+			__m128 step0 = _mm_mul_ps(a0, _mm_set1_ps(4)), step1 = _mm_mul_ps(a1, _mm_set1_ps(4));
+			__m128 step2 = _mm_mul_ps(a2, _mm_set1_ps(4)), stepz = _mm_mul_ps(zx, _mm_set1_ps(4));
+			__m128 zero = _mm_setzero_ps();
+			__m128i color = _mm_set1_epi32((int) t.color);
+			for (int x = bx0; x <= bx1; x += 4) {
+				__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)),
+						_mm_cmpge_ps(e2, zero));
+				if (_mm_movemask_ps(inside)) {
+					__m128 old_z = _mm_load_ps(zrow + x);
+					__m128 pass = _mm_and_ps(inside, _mm_cmple_ps(z, old_z));
+					_mm_store_ps(zrow + x, _mm_or_ps(_mm_and_ps(pass, z), _mm_andnot_ps(pass, old_z)));
+					__m128i m = _mm_castps_si128(pass);
+					__m128i old_c = _mm_load_si128((__m128i*) (crow + x));
+					_mm_store_si128((__m128i*) (crow + x),
+							_mm_or_si128(_mm_and_si128(m, color), _mm_andnot_si128(m, old_c)));
+				}
+				e0 = _mm_add_ps(e0, step0);
+				e1 = _mm_add_ps(e1, step1);
+				e2 = _mm_add_ps(e2, step2);
+				z = _mm_add_ps(z, stepz);
+			}
+#else
+			for (int x = bx0; x <= bx1; x++) {
+				float px = x + 0.5f;
+				if (t.a[0] * px + t.b[0] * py + t.c[0] < 0 || t.a[1] * px + t.b[1] * py + t.c[1] < 0
+						|| t.a[2] * px + t.b[2] * py + t.c[2] < 0)
+					continue;
+				float z = t.zx * px + t.zy * py + t.zc;
+				if (z <= zrow[x]) {
+					zrow[x] = z;
+					crow[x] = t.color;
+				}
+			}
+#endif
+		}
+	}
+}
+
+static void run_tiles (SoftRaster *r)
+{
+	int count = r->tiles_x * r->tiles_y;
+	for (int tile; (tile = r->next_tile++) < count; )
+		raster_tile(r, tile);
+}
+
+void soft_finish (SoftRaster *r)
+{
+	r->next_tile = 0;
+	{
+		lock_guard<mutex> lock(r->mutex);
+		r->busy = r->workers.size();
+		r->generation++;
+		r->wake.notify_all();
+	}
+	run_tiles(r);
+	{
+		unique_lock<mutex> lock(r->mutex);
+		r->done.wait(lock, [&] { return r->busy == 0; });
+	}
+
+	r->clear_pending = false;
+	r->triangles.clear();
+	for (size_t i=0; i<r->bins.size(); i++)
+		r->bins[i].clear();
+}
+
+bool soft_write_ppm (const SoftRaster *r, const char *path)
+{
+	FILE *fp = fopen(path, "wb");
+	if (!fp)
+		return false;
+	fprintf(fp, "P6\n%d %d\n255\n", r->width, r->height);
+	vector<unsigned char> row(3 * r->width);
+	bool ok = true;
+	for (int y=0; y<r->height && ok; y++) {
+		const uint32_t *c = r->color + (size_t) y * r->stride;
+		for (int x=0; x<r->width; x++) {
+			row[3*x] = c[x] & 0xFF;
+			row[3*x + 1] = (c[x] >> 8) & 0xFF;
+			row[3*x + 2] = (c[x] >> 16) & 0xFF;
+		}
+		ok = fwrite(&row[0], 1, row.size(), fp) == row.size();
+	}
+	return fclose(fp) == 0 && ok;
+}
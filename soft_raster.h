@@ -0,0 +1,72 @@
+#ifndef SOFT_RASTER_H
+#define SOFT_RASTER_H
+
+#include <stdint.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+#include "scene_geometry.h"
+
+/* CPU renderer for machines without a GPU (CI, batch rendering).
+ *
+ * Draws the same MeshData with the same column-major MVP matrices as the
+ * GL path: triangles are clipped against the near plane, set up as edge
+ * functions and binned into SOFT_TILE x SOFT_TILE screen tiles. soft_finish
+ * then rasterizes the tiles on a thread pool, four pixels at a time with
+ * SSE2, depth tested like GL_LEQUAL. Each triangle is flat shaded with the
+ * mean of its vertex colours.
+ *
+ *   SoftRaster r;
+ *   soft_create(&r, 1000, 1000, 0);
+ *   soft_clear(&r, 0.3f, 0.3f, 0.3f);
+ *   soft_draw(&r, &floor_mesh, mvp);   // any number of times
+ *   soft_finish(&r);                   // r.color now holds the frame
+ *   soft_write_ppm(&r, "frame.ppm");
+ */
+
+#define SOFT_TILE 64
+
+struct SoftTriangle {
+	float a[3], b[3], c[3];  // edge i is a*x + b*y + c, >= 0 inside
+	float zx, zy, zc;        // window depth plane
+	uint32_t color;
+	int min_x, min_y, max_x, max_y; // pixel bounds, inclusive
+};
+
+struct SoftRaster {
+	int width, height;
+	int stride;              // pixels per row, whole tiles
+	int tiles_x, tiles_y;
+	uint32_t *color;         // RGBA8, R in the low byte, top row first
+	float *depth;
+
+	bool clear_pending;
+	uint32_t clear_color;
+	std::vector<SoftTriangle> triangles;
+	std::vector< std::vector<uint32_t> > bins; // triangle indices per tile, in draw order
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake, done;
+	uint64_t generation;     // bumped per soft_finish
+	int busy;                // workers still on this generation
+	bool stop;
+	std::atomic<int> next_tile;
+};
+
+/* threads = 0 uses every hardware thread */
+void soft_create (SoftRaster *r, int width, int height, int threads);
+void soft_destroy (SoftRaster *r);
+
+/* Clear colour and depth (to 1) before the next draws */
+void soft_clear (SoftRaster *r, float red, float green, float blue);
+void soft_draw (SoftRaster *r, const MeshData *mesh, const float mvp[16]);
+/* Rasterize everything drawn since the last finish */
+void soft_finish (SoftRaster *r);
+
+bool soft_write_ppm (const SoftRaster *r, const char *path);
+
+#endif
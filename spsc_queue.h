@@ -0,0 +1,57 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+/* Bounded single-producer single-consumer ring. push() and pop() are
+   wait-free: each side touches only its own index plus a cached copy of
+   the other one, and a full queue rejects the push instead of blocking. */
+template <class T, size_t N>
+class SpscQueue
+{
+	static_assert((N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+	public:
+	SpscQueue() : head(0), tail(0), head_cache(0), tail_cache(0) {}
+
+	/* Producer side */
+	bool push (const T &value)
+	{
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h - tail_cache == N)
+		{
+			tail_cache = tail.load(std::memory_order_acquire);
+			if (h - tail_cache == N)
+				return false;
+		}
+		buffer[h & (N - 1)] = value;
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	/* Consumer side */
+	bool pop (T &value)
+	{
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (t == head_cache)
+		{
+			head_cache = head.load(std::memory_order_acquire);
+			if (t == head_cache)
+				return false;
+		}
+		value = buffer[t & (N - 1)];
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	private:
+	// Producer and consumer fields on separate cache lines
+	alignas(64) std::atomic<size_t> head;
+	alignas(64) std::atomic<size_t> tail;
+	alignas(64) size_t head_cache; // consumer's view of head
+	alignas(64) size_t tail_cache; // producer's view of tail
+	alignas(64) T buffer[N];
+};
+
+#endif
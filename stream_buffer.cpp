@@ -0,0 +1,128 @@
+#include <chrono>
+
+#include "log.h"
+#include "stream_buffer.h"
+
+using namespace std;
+
+void stream_buffer_create (StreamBuffer *stream, GLenum target, size_t frame_size)
+{
+	stream->target = target;
+	stream->frame_size = frame_size;
+	stream->region = STREAM_FRAMES - 1; // first begin_frame moves to 0
+	stream->used = 0;
+	stream->mapped = stream->ring = NULL;
+	for (int i=0; i<STREAM_FRAMES; i++)
+		stream->fences[i] = 0;
+	stream->frames = stream->waits = stream->overflows = 0;
+	stream->wait_time = 0;
+
+	size_t size = frame_size * STREAM_FRAMES;
+	stream->buffer = GpuBuffer::create();
+	glBindBuffer(target, stream->buffer.get());
+	stream->persistent = GLAD_GL_ARB_buffer_storage != 0;
+	if (stream->persistent) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(target, size, NULL, flags);
+		stream->buffer.set_bytes(size);
+		stream->ring = (char*) glMapBufferRange(target, 0, size, flags);
+		if (!stream->ring) {
+			// Storage is immutable now; start over with a plain buffer
+			stream->persistent = false;
+			stream->buffer = GpuBuffer::create();
+		}
+	}
+	if (!stream->persistent)
+		gpu_buffer_data(stream->buffer, target, size, NULL, GL_STREAM_DRAW);
+}
+
+void stream_buffer_destroy (StreamBuffer *stream)
+{
+	for (int i=0; i<STREAM_FRAMES; i++) {
+		if (stream->fences[i])
+			glDeleteSync(stream->fences[i]);
+		stream->fences[i] = 0;
+	}
+	if (stream->ring || stream->mapped) {
+		glBindBuffer(stream->target, stream->buffer.get());
+		glUnmapBuffer(stream->target);
+	}
+	stream->ring = stream->mapped = NULL;
+	stream->buffer.reset();
+}
+
+void stream_begin_frame (StreamBuffer *stream)
+{
+	stream->region = (stream->region + 1) % STREAM_FRAMES;
+	stream->used = 0;
+	stream->frames++;
+
+	GLsync &fence = stream->fences[stream->region];
+	if (fence) {
+		GLenum status = glClientWaitSync(fence, 0, 0);
+		if (status == GL_TIMEOUT_EXPIRED) {
+			// The GPU is STREAM_FRAMES behind; block until it catches up
+			stream->waits++;
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			do
+				status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+			while (status == GL_TIMEOUT_EXPIRED);
+			stream->wait_time += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		}
+		glDeleteSync(fence);
+		fence = 0;
+	}
+
+	size_t start = stream->region * stream->frame_size;
+	if (stream->persistent) {
+		stream->mapped = stream->ring + start;
+	}
+	else {
+		// Idle per the fence, so no need for the driver to synchronise
+		glBindBuffer(stream->target, stream->buffer.get());
+		stream->mapped = (char*) glMapBufferRange(stream->target, start, stream->frame_size,
+				GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT);
+	}
+}
+
+void *stream_alloc (StreamBuffer *stream, size_t bytes, size_t align, GLintptr *offset)
+{
+	size_t at = (stream->used + align - 1) & ~(align - 1);
+	if (!stream->mapped || at + bytes > stream->frame_size) {
+		stream->overflows++;
+		LOG(LOG_WARN, "stream buffer: %zu bytes asked, %zu of %zu used this frame", bytes, stream->used, stream->frame_size);
+		return NULL;
+	}
+	stream->used = at + bytes;
+	*offset = stream->region * stream->frame_size + at;
+	return stream->mapped + at;
+}
+
+void stream_end_frame (StreamBuffer *stream)
+{
+	if (!stream->persistent && stream->mapped) {
+		glBindBuffer(stream->target, stream->buffer.get());
+		if (stream->used)
+			glFlushMappedBufferRange(stream->target, 0, stream->used);
+		glUnmapBuffer(stream->target);
+	}
+	stream->mapped = NULL;
+}
+
+void stream_fence (StreamBuffer *stream)
+{
+	GLsync &fence = stream->fences[stream->region];
+	if (fence)
+		glDeleteSync(fence);
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void stream_report (const StreamBuffer *stream, const char *name, FILE *fp)
+{
+	if (stream->frames == 0)
+		return;
+	fprintf(fp, "STREAM %s: %s, %ld frames, %ld fence waits (%.1f%%, %.2f ms total), %ld overflows\n", name,
+			stream->persistent ? "persistent mapping" : "unsynchronized mapping",
+			stream->frames, stream->waits, 100.0 * stream->waits / stream->frames,
+			1000 * stream->wait_time, stream->overflows);
+}
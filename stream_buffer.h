@@ -0,0 +1,63 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <glad/glad.h>
+
+#include "gpu_handle.h"
+
+/* Per-frame upload space that never stalls on the GPU or copies twice.
+ *
+ * The buffer is a ring of STREAM_FRAMES regions; each frame writes into
+ * the next region through a mapped pointer, and a fence placed at the end
+ * of the frame keeps the region from being reused until the GPU is done
+ * with it. With ARB_buffer_storage the whole ring is mapped once,
+ * persistent and coherent; otherwise each frame's region is mapped
+ * unsynchronized (the fence already guarantees it's idle) and flushed at
+ * the end of the frame.
+ *
+ *   stream_begin_frame(&s);
+ *   GLintptr at;
+ *   float *p = (float*) stream_alloc(&s, bytes, 16, &at);  // fill p...
+ *   stream_end_frame(&s);  // before issuing the draws that read at
+ *   ...draws...
+ *   stream_fence(&s);
+ */
+
+#define STREAM_FRAMES 3
+
+struct StreamBuffer {
+	GpuBuffer buffer;
+	GLenum target;
+	size_t frame_size;  // bytes per region
+	bool persistent;
+	char *ring;         // persistent mapping of all regions, else NULL
+	char *mapped;       // current region while a frame is open
+	int region;
+	size_t used;        // bytes handed out from the current region
+	GLsync fences[STREAM_FRAMES];
+
+	long frames;
+	long waits;         // frames that found their region still in use
+	double wait_time;   // seconds blocked on those
+	long overflows;     // allocations that didn't fit
+};
+
+void stream_buffer_create (StreamBuffer *stream, GLenum target, size_t frame_size);
+void stream_buffer_destroy (StreamBuffer *stream);
+
+/* Move to the next region, waiting for the GPU if it still reads it */
+void stream_begin_frame (StreamBuffer *stream);
+/* Space for bytes, aligned to align (a power of two); *offset is where it
+   is in the buffer. NULL if the region is full. */
+void *stream_alloc (StreamBuffer *stream, size_t bytes, size_t align, GLintptr *offset);
+/* Make the writes visible; call before the draws using them, and fence
+   the region after them with stream_fence */
+void stream_end_frame (StreamBuffer *stream);
+/* After the last draw reading this frame's region */
+void stream_fence (StreamBuffer *stream);
+
+void stream_report (const StreamBuffer *stream, const char *name, FILE *fp);
+
+#endif
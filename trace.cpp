@@ -0,0 +1,144 @@
+#include <cstdio>
+#include <chrono>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+
+#include "trace.h"
+
+using namespace std;
+
+struct TraceBuffer {
+	vector<TraceEvent*> chunks;
+	long count;
+	long dropped;
+	const char *thread_name;
+};
+
+bool trace_enabled;
+
+// Buffers are claimed by threads on their first event; trace_write reads
+// the first num_buffers of them
+static TraceBuffer buffers[TRACE_MAX_THREADS];
+static std::atomic<int> num_buffers(0);
+static thread_local TraceBuffer *my_buffer;
+static thread_local bool no_buffer;
+static chrono::steady_clock::time_point trace_origin;
+
+void trace_start ()
+{
+	trace_origin = chrono::steady_clock::now();
+	trace_enabled = true;
+}
+
+static TraceBuffer *thread_buffer ()
+{
+	if (!my_buffer && !no_buffer) {
+		int index = num_buffers.fetch_add(1, std::memory_order_acq_rel);
+		if (index < TRACE_MAX_THREADS)
+			my_buffer = &buffers[index];
+		else
+			no_buffer = true;
+	}
+	return my_buffer;
+}
+
+static void add (char phase, const char *name, double value)
+{
+	int64_t now = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - trace_origin).count();
+	TraceBuffer *buffer = thread_buffer();
+	if (!buffer)
+		return;
+	if (buffer->count >= TRACE_MAX_EVENTS) {
+		buffer->dropped++;
+		return;
+	}
+	if (buffer->count % TRACE_CHUNK == 0)
+		buffer->chunks.push_back(new TraceEvent[TRACE_CHUNK]);
+	TraceEvent &event = buffer->chunks.back()[buffer->count % TRACE_CHUNK];
+	event.time = now;
+	event.name = name;
+	event.value = value;
+	event.phase = phase;
+	buffer->count++;
+}
+
+void trace_thread_name (const char *name)
+{
+	if (!trace_enabled)
+		return;
+	TraceBuffer *buffer = thread_buffer();
+	if (buffer)
+		buffer->thread_name = name;
+}
+
+void trace_begin (const char *name)
+{
+	if (trace_enabled)
+		add(TRACE_BEGIN, name, 0);
+}
+
+void trace_end ()
+{
+	if (trace_enabled)
+		add(TRACE_END, NULL, 0);
+}
+
+void trace_counter (const char *name, double value)
+{
+	if (trace_enabled)
+		add(TRACE_COUNTER, name, value);
+}
+
+bool trace_write (const char *path)
+{
+	if (!trace_enabled)
+		return true;
+	trace_enabled = false;
+	FILE *fp = fopen(path, "w");
+	if (!fp) {
+		perror(path);
+		return false;
+	}
+
+	// One process; thread ids are buffer indices. Events are already in
+	// time order within each thread, which is all the viewers need
+	fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	const char *separator = "";
+	long written = 0, dropped = 0;
+	int n = min(num_buffers.load(std::memory_order_acquire), TRACE_MAX_THREADS);
+	for (int tid=0; tid<n; tid++) {
+		TraceBuffer *buffer = &buffers[tid];
+		if (buffer->thread_name) {
+			fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+					separator, tid, buffer->thread_name);
+			separator = ",\n";
+		}
+		for (long i=0; i<buffer->count; i++) {
+			const TraceEvent &event = buffer->chunks[i / TRACE_CHUNK][i % TRACE_CHUNK];
+			fprintf(fp, "%s{\"ph\":\"%c\",\"pid\":1,\"tid\":%d,\"ts\":%.3f", separator, event.phase, tid, event.time / 1000.0);
+			if (event.name)
+				fprintf(fp, ",\"name\":\"%s\"", event.name);
+			if (event.phase == TRACE_COUNTER)
+				fprintf(fp, ",\"args\":{\"value\":%.17g}", event.value);
+			fprintf(fp, "}");
+			separator = ",\n";
+		}
+		written += buffer->count;
+		dropped += buffer->dropped;
+
+		for (size_t c=0; c<buffer->chunks.size(); c++)
+			delete[] buffer->chunks[c];
+		buffer->chunks.clear();
+		buffer->count = buffer->dropped = 0;
+	}
+	fprintf(fp, "\n]}\n");
+	bool ok = !ferror(fp);
+	if (fclose(fp) != 0)
+		ok = false;
+	printf("TRACE: %ld events from %d threads written to %s", written, n, path);
+	if (dropped > 0)
+		printf(", %ld dropped past %d per thread", dropped, TRACE_MAX_EVENTS);
+	printf("\n");
+	return ok;
+}
@@ -0,0 +1,70 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+/* Timeline tracing in Chrome's Trace Event JSON, for chrome://tracing or
+ * ui.perfetto.dev.
+ *
+ *   void draw ()
+ *   {
+ *       TRACE_SCOPE("draw");       // a span until the end of the block
+ *       ...
+ *       trace_counter("draw calls", draw_calls);
+ *   }
+ *
+ * Spans nest per thread. Each thread appends fixed-size TraceEvents to its
+ * own buffer, in chunks of TRACE_CHUNK that are never moved: no locks, no
+ * formatting and no I/O while tracing. trace_write turns them all into JSON
+ * at exit, once the traced threads have stopped. Names must be string
+ * literals (only the pointer is kept) without quotes or backslashes.
+ *
+ * Until trace_start, every call costs a load and a branch.
+ */
+
+#define TRACE_CHUNK 4096              // events per allocation
+#define TRACE_MAX_EVENTS (1 << 22)    // per thread; later events are dropped
+#define TRACE_MAX_THREADS 16
+
+enum TracePhase { TRACE_BEGIN = 'B', TRACE_END = 'E', TRACE_COUNTER = 'C' };
+
+struct TraceEvent {
+	int64_t time;         // ns since trace_start
+	const char *name;     // NULL for TRACE_END
+	double value;         // TRACE_COUNTER
+	char phase;
+};
+
+extern bool trace_enabled;
+
+/* Before starting the threads to be traced */
+void trace_start ();
+/* Name the calling thread in the viewer */
+void trace_thread_name (const char *name);
+
+void trace_begin (const char *name);
+void trace_end ();
+void trace_counter (const char *name, double value);
+
+/* After the traced threads have stopped; false if path can't be written */
+bool trace_write (const char *path);
+
+struct TraceScope {
+	bool active;
+	TraceScope (const char *name) : active(trace_enabled)
+	{
+		if (active)
+			trace_begin(name);
+	}
+	~TraceScope ()
+	{
+		if (active)
+			trace_end();
+	}
+};
+
+#define TRACE_CONCAT2(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT2(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+
+#endif
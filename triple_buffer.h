@@ -0,0 +1,52 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+/* Lock-free triple buffer for handing the newest complete value from one
+   producer thread to one consumer thread. The producer fills
+   write_buffer() and publish()es it; the consumer's read() returns the
+   newest published value and keeps it stable until the next read().
+   Neither side ever waits for the other; stale values are overwritten. */
+template <class T>
+class TripleBuffer
+{
+	enum { FRESH = 4, INDEX = 3 };
+
+	public:
+	TripleBuffer (const T &initial) : back(0), front(2), middle(1)
+	{
+		for (int i=0; i<3; i++)
+			slots[i].value = initial;
+	}
+
+	/* Producer side */
+	T& write_buffer ()
+	{
+		return slots[back].value;
+	}
+
+	void publish ()
+	{
+		back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+	}
+
+	/* Consumer side */
+	const T& read ()
+	{
+		if (middle.load(std::memory_order_relaxed) & FRESH)
+			front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+		return slots[front].value;
+	}
+
+	private:
+	struct alignas(64) Slot {
+		T value;
+	};
+	Slot slots[3];
+	int back;  // producer only
+	int front; // consumer only
+	alignas(64) std::atomic<int> middle;
+};
+
+#endif